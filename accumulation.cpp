@@ -0,0 +1,59 @@
+
+#include <cassert>
+#include <limits>
+
+#include "accumulation.h"
+
+
+void Accumulation::add( const int px, const int py, const Color& color )
+{
+    unsigned id= offset(px, py);
+    assert(id < m_count.size());
+
+    m_sum[id]= m_sum[id] + color;
+
+    // moyenne et variance de la luminance, en une seule passe
+    float y= 0.2126f * color.r + 0.7152f * color.g + 0.0722f * color.b;
+    int n= ++m_count[id];
+    float delta= y - m_mean[id];
+    m_mean[id]= m_mean[id] + delta / n;
+    m_m2[id]= m_m2[id] + delta * (y - m_mean[id]);
+}
+
+Color Accumulation::color( const int px, const int py ) const
+{
+    unsigned id= offset(px, py);
+    if(m_count[id] == 0)
+        return Black();
+
+    return m_sum[id] / float(m_count[id]);
+}
+
+float Accumulation::variance( const int px, const int py ) const
+{
+    unsigned id= offset(px, py);
+    int n= m_count[id];
+    if(n < 2)
+        return std::numeric_limits<float>::infinity();
+
+    // variance des echantillons / n
+    return m_m2[id] / float(n - 1) / float(n);
+}
+
+long int Accumulation::total( ) const
+{
+    long int n= 0;
+    for(int count : m_count)
+        n+= count;
+    return n;
+}
+
+void Accumulation::resolve( Image& image ) const
+{
+    assert(image.width() == m_width && image.height() == m_height);
+
+#pragma omp parallel for schedule(static)
+    for(int py= 0; py < m_height; py++)
+    for(int px= 0; px < m_width; px++)
+        image(px, py)= color(px, py);
+}
@@ -0,0 +1,134 @@
+
+#ifndef _ACCUMULATION_H
+#define _ACCUMULATION_H
+
+#include <vector>
+
+#include "color.h"
+#include "image.h"
+#include "render.h"
+
+
+//! \addtogroup image
+///@{
+
+//! \file
+//! rendu progressif : accumulation de plusieurs echantillons par pixel, et arret adaptatif des pixels qui ont converge.
+
+/*! position du ieme echantillon d'un pixel, dans [0 .. 1[ x [0 .. 1[.
+    suite R2 (Roberts) : les premiers echantillons sont bien repartis dans le pixel, quel que soit leur nombre.
+*/
+inline void sample_offset( const int i, float& u, float& v )
+{
+    // 1 / g et 1 / g^2, g racine reelle de x^3 = x + 1
+    const double a1= 0.7548776662466927;
+    const double a2= 0.5698402909980532;
+    double x= 0.5 + a1 * i;
+    double y= 0.5 + a2 * i;
+    u= float(x - int(x));
+    v= float(y - int(y));
+}
+
+/*! tampon d'accumulation d'une image width x height : somme des echantillons de chaque pixel, et moyenne / variance de leur luminance, calculees incrementalement.
+    chaque pixel n'est modifie que par le thread qui calcule sa tuile, cf render_progressive().
+*/
+struct Accumulation
+{
+    Accumulation( const int w, const int h ) : m_sum(w*h, Color(0, 0, 0, 0)), m_mean(w*h, 0), m_m2(w*h, 0), m_count(w*h, 0), m_width(w), m_height(h) {}
+
+    //! ajoute un echantillon au pixel (px, py).
+    void add( const int px, const int py, const Color& color );
+
+    //! renvoie la moyenne des echantillons du pixel, ou noir s'il n'a pas encore d'echantillon.
+    Color color( const int px, const int py ) const;
+
+    //! renvoie le nombre d'echantillons du pixel.
+    int samples( const int px, const int py ) const { return m_count[offset(px, py)]; }
+
+    //! renvoie la variance de la moyenne de la luminance du pixel, ou inf avec moins de 2 echantillons.
+    float variance( const int px, const int py ) const;
+
+    //! renvoie le nombre total d'echantillons.
+    long int total( ) const;
+
+    //! copie la moyenne de chaque pixel dans l'image, de meme dimension.
+    void resolve( Image& image ) const;
+
+    int width( ) const { return m_width; }
+    int height( ) const { return m_height; }
+
+protected:
+    unsigned offset( const int px, const int py ) const { return py * m_width + px; }
+
+    std::vector<Color> m_sum;       // somme des echantillons
+    std::vector<float> m_mean;      // moyenne de la luminance
+    std::vector<float> m_m2;        // somme des carres des ecarts a la moyenne de la luminance, algorithme de Welford
+    std::vector<int> m_count;
+    int m_width;
+    int m_height;
+};
+
+
+/*! rendu progressif : complete chaque pixel jusqu'a samples echantillons, en une passe par echantillon.
+    shader(x, y) renvoie la couleur du point (x, y) de l'image, les coordonnees ne sont pas entieres, cf sample_offset().
+
+    echantillonnage adaptatif : un pixel qui a au moins min_samples echantillons n'en recoit plus si l'ecart type de sa luminance moyenne est inferieur a threshold.
+    les regions uniformes (ciel, plan) s'arretent apres min_samples echantillons, les bords des objets en recoivent plus.
+    threshold= 0 calcule samples echantillons pour tous les pixels.
+
+    l'accumulation conserve les echantillons deja calcules : appeler render_progressive() avec un nombre croissant d'echantillons affine l'image.
+    renvoie le nombre d'echantillons calcules.
+
+    exemple :
+    \code
+    Accumulation accumulation(image.width(), image.height());
+    for(int n= 1; n <= 64; n*= 2)
+    {
+        render_progressive(accumulation, [&]( const float x, const float y ) { ... }, n, 0.002);
+        accumulation.resolve(image);
+        write_image(image, "progressif.png");
+    }
+    \endcode
+*/
+template < typename Shader >
+long int render_progressive( Accumulation& accumulation, Shader shader, const int samples, const float threshold= 0, const int min_samples= 4, const int size= TILE_SIZE )
+{
+    const float threshold2= threshold * threshold;
+    long int total= 0;
+    for(int pass= 0; pass < samples; pass++)
+    {
+        long int count= 0;
+        for_each_tile(accumulation.width(), accumulation.height(),
+            [&]( const Tile& t )
+            {
+                long int n= 0;
+                for(int py= t.y0; py < t.y1; py++)
+                for(int px= t.x0; px < t.x1; px++)
+                {
+                    int s= accumulation.samples(px, py);
+                    if(s >= samples)
+                        continue;
+                    if(s >= min_samples && accumulation.variance(px, py) < threshold2)
+                        continue;   // le pixel a converge
+
+                    float u, v;
+                    sample_offset(s, u, v);
+                    accumulation.add(px, py, shader(px + u, py + v));
+                    n++;
+                }
+
+            #pragma omp atomic
+                count+= n;
+            },
+            size);
+
+        if(count == 0)
+            break;  // tous les pixels ont converge
+        total+= count;
+    }
+
+    return total;
+}
+
+///@}
+#endif
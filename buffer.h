@@ -0,0 +1,98 @@
+
+#ifndef _BUFFER_H
+#define _BUFFER_H
+
+#include <cassert>
+#include <cstddef>
+#include <memory>
+#include <utility>
+#include <vector>
+
+
+//! \file
+//! tableau qui possede ses elements, comme std::vector, ou qui reference des elements stockes ailleurs, par exemple dans un fichier projete en memoire.
+
+/*! tableau d'elements, utilisable comme un std::vector.
+    Buffer peut aussi referencer des elements qu'il ne possede pas, cf Buffer(data, n, owner) : les elements sont utilises directement, sans copie,
+    et owner garde la memoire valide tant qu'un Buffer la reference. par exemple, owner peut etre le fichier projete en memoire qui contient les elements, cf MappedFile.
+    les elements references sont en lecture seule : un acces non const, ou une modification du tableau, copie d'abord les elements.
+*/
+template < typename T >
+class Buffer
+{
+public:
+    //! tableau vide.
+    Buffer( ) : m_vector(), m_data(nullptr), m_size(0), m_owner() {}
+    //! tableau de n elements, initialises a value.
+    explicit Buffer( const size_t n, const T& value= T() ) : m_vector(n, value), m_data(m_vector.data()), m_size(n), m_owner() {}
+    //! copie les elements d'un std::vector.
+    Buffer( const std::vector<T>& v ) : m_vector(v), m_data(m_vector.data()), m_size(v.size()), m_owner() {}
+    //! reference n elements stockes en data, sans les copier. owner garde la memoire valide.
+    Buffer( const T *data, const size_t n, const std::shared_ptr<const void>& owner ) : m_vector(), m_data(data), m_size(n), m_owner(owner) {}
+
+    Buffer( const Buffer& b ) : m_vector(b.m_vector), m_data(b.m_owner ? b.m_data : m_vector.data()), m_size(b.m_size), m_owner(b.m_owner) {}
+    Buffer& operator= ( const Buffer& b )
+    {
+        m_vector= b.m_vector;
+        m_owner= b.m_owner;
+        m_data= m_owner ? b.m_data : m_vector.data();
+        m_size= b.m_size;
+        return *this;
+    }
+
+    Buffer( Buffer&& b ) : m_vector(std::move(b.m_vector)), m_data(b.m_owner ? b.m_data : m_vector.data()), m_size(b.m_size), m_owner(std::move(b.m_owner)) { b.update(); }
+    Buffer& operator= ( Buffer&& b )
+    {
+        bool owner= bool(b.m_owner);
+        m_vector= std::move(b.m_vector);
+        m_owner= std::move(b.m_owner);
+        m_data= owner ? b.m_data : m_vector.data();
+        m_size= b.m_size;
+        b.update();
+        return *this;
+    }
+
+    //! renvoie vrai si les elements sont references, et pas possedes par le tableau.
+    bool borrowed( ) const { return bool(m_owner); }
+
+    size_t size( ) const { return m_size; }
+    bool empty( ) const { return m_size == 0; }
+
+    const T *data( ) const { return m_data; }
+    T *data( ) { detach(); return m_vector.data(); }
+
+    const T& operator[] ( const size_t i ) const { assert(i < m_size); return m_data[i]; }
+    T& operator[] ( const size_t i ) { assert(i < m_size); detach(); return m_vector[i]; }
+
+    const T *begin( ) const { return m_data; }
+    const T *end( ) const { return m_data + m_size; }
+    T *begin( ) { return data(); }
+    T *end( ) { return data() + m_size; }
+
+    void clear( ) { m_owner.reset(); m_vector.clear(); update(); }
+    void reserve( const size_t n ) { detach(); m_vector.reserve(n); update(); }
+    void resize( const size_t n, const T& value= T() ) { detach(); m_vector.resize(n, value); update(); }
+    void assign( const size_t n, const T& value ) { m_owner.reset(); m_vector.assign(n, value); update(); }
+    void push_back( const T& value ) { detach(); m_vector.push_back(value); update(); }
+
+protected:
+    // copie les elements references, pour pouvoir les modifier
+    void detach( )
+    {
+        if(!m_owner)
+            return;
+
+        m_vector.assign(m_data, m_data + m_size);
+        m_owner.reset();
+        update();
+    }
+
+    void update( ) { m_data= m_vector.data(); m_size= m_vector.size(); }
+
+    std::vector<T> m_vector;
+    const T *m_data;
+    size_t m_size;
+    std::shared_ptr<const void> m_owner;
+};
+
+#endif
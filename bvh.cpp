@@ -0,0 +1,145 @@
+
+#include <cassert>
+#include <algorithm>
+
+#include "bvh.h"
+
+
+// nombre d'intervalles utilises pour evaluer la SAH sur chaque axe
+const int BINS= 16;
+
+
+void BVH::build( const std::vector<BBox>& bounds, const int max_leaf )
+{
+    clear();
+
+    int n= int(bounds.size());
+    if(n == 0)
+        return;
+
+    std::vector<Point> centroids(n);
+    indices.resize(n);
+    for(int i= 0; i < n; i++)
+    {
+        centroids[i]= bounds[i].centroid();
+        indices[i]= i;
+    }
+
+    // un arbre binaire avec au moins 1 objet par feuille a au plus 2n -1 noeuds
+    nodes.reserve(2*n);
+    nodes.push_back( BVHNode() );
+    build_node(0, 0, n, bounds, centroids, std::max(max_leaf, 1), 0);
+}
+
+void BVH::build_node( const int node, const int begin, const int end, const std::vector<BBox>& bounds, const std::vector<Point>& centroids, const int max_leaf, const int depth )
+{
+    // englobant des objets et de leurs centres
+    BBox box;
+    BBox cbox;
+    for(int i= begin; i < end; i++)
+    {
+        box.insert(bounds[indices[i]]);
+        cbox.insert(centroids[indices[i]]);
+    }
+
+    nodes[node].bounds= box;
+    nodes[node].first= begin;
+    nodes[node].count= end - begin;
+
+    int n= end - begin;
+    if(n == 1 || depth >= BVH_MAX_DEPTH)
+        return;
+
+    // evalue la SAH sur chaque axe
+    float best_cost= std::numeric_limits<float>::max();
+    int best_axis= -1;
+    int best_split= 0;
+    for(int axis= 0; axis < 3; axis++)
+    {
+        float cmin= cbox.pmin(axis);
+        float cmax= cbox.pmax(axis);
+        if(cmax - cmin <= 0)
+            continue;       // tous les centres sont confondus sur cet axe
+
+        int counts[BINS]= {};
+        BBox boxes[BINS];
+        float scale= BINS / (cmax - cmin);
+        for(int i= begin; i < end; i++)
+        {
+            int b= std::min(int((centroids[indices[i]](axis) - cmin) * scale), BINS -1);
+            counts[b]++;
+            boxes[b].insert(bounds[indices[i]]);
+        }
+
+        // balaye les intervalles de droite a gauche, puis de gauche a droite
+        float right_area[BINS];
+        int right_count[BINS];
+        BBox right;
+        int rcount= 0;
+        for(int b= BINS -1; b > 0; b--)
+        {
+            right.insert(boxes[b]);
+            rcount+= counts[b];
+            right_area[b]= right.area();
+            right_count[b]= rcount;
+        }
+
+        BBox left;
+        int lcount= 0;
+        for(int b= 1; b < BINS; b++)
+        {
+            left.insert(boxes[b -1]);
+            lcount+= counts[b -1];
+            if(lcount == 0 || right_count[b] == 0)
+                continue;
+
+            float cost= left.area() * lcount + right_area[b] * right_count[b];
+            if(cost < best_cost)
+            {
+                best_cost= cost;
+                best_axis= axis;
+                best_split= b;
+            }
+        }
+    }
+
+    // cout relatif au parcours du noeud : 1 test d'englobant + les objets des fils, ponderes par la probabilite de les visiter
+    float area= box.area();
+    float split_cost= (area > 0) ? 1 + best_cost / area : float(n);
+    if(best_axis == -1 || (n <= max_leaf && split_cost >= float(n)))
+    {
+        if(n <= max_leaf)
+            return;
+
+        // tous les centres sont confondus mais la feuille serait trop grosse : coupe au milieu
+        best_axis= -1;
+    }
+
+    int middle;
+    if(best_axis != -1)
+    {
+        float cmin= cbox.pmin(best_axis);
+        float scale= BINS / (cbox.pmax(best_axis) - cmin);
+        int *p= std::partition(indices.data() + begin, indices.data() + end,
+            [&]( const int id )
+            {
+                int b= std::min(int((centroids[id](best_axis) - cmin) * scale), BINS -1);
+                return b < best_split;
+            });
+        middle= int(p - indices.data());
+    }
+    else
+        middle= (begin + end) / 2;
+
+    assert(middle > begin && middle < end);
+
+    // les 2 fils sont toujours consecutifs
+    int left= int(nodes.size());
+    nodes.push_back( BVHNode() );
+    nodes.push_back( BVHNode() );
+    nodes[node].first= left;
+    nodes[node].count= 0;
+
+    build_node(left, begin, middle, bounds, centroids, max_leaf, depth +1);
+    build_node(left +1, middle, end, bounds, centroids, max_leaf, depth +1);
+}
@@ -0,0 +1,204 @@
+
+#ifndef _BVH_H
+#define _BVH_H
+
+#include <vector>
+#include <limits>
+#include <algorithm>
+#include <cmath>
+
+#include "vec.h"
+#include "buffer.h"
+
+
+//! \addtogroup math
+///@{
+
+//! \file
+//! hierarchie de volumes englobants, construite avec l'heuristique SAH.
+
+//! boite englobante alignee sur les axes.
+struct BBox
+{
+    //! constructeur par defaut, boite vide.
+    BBox( ) : pmin( std::numeric_limits<float>::max(),  std::numeric_limits<float>::max(),  std::numeric_limits<float>::max()),
+              pmax(-std::numeric_limits<float>::max(), -std::numeric_limits<float>::max(), -std::numeric_limits<float>::max()) {}
+    //! boite [a .. b].
+    BBox( const Point& a, const Point& b ) : pmin(a), pmax(b) {}
+
+    //! agrandit la boite pour inclure le point p.
+    BBox& insert( const Point& p ) { pmin= min(pmin, p); pmax= max(pmax, p); return *this; }
+    //! agrandit la boite pour inclure la boite b.
+    BBox& insert( const BBox& b ) { pmin= min(pmin, b.pmin); pmax= max(pmax, b.pmax); return *this; }
+
+    //! renvoie le centre de la boite.
+    Point centroid( ) const { return center(pmin, pmax); }
+
+    //! renvoie l'aire de la boite, ou 0 si la boite est vide.
+    float area( ) const
+    {
+        Vector d(pmin, pmax);
+        if(d.x < 0 || d.y < 0 || d.z < 0)
+            return 0;
+        return 2 * (d.x*d.y + d.x*d.z + d.y*d.z);
+    }
+
+    /*! intersection avec le rayon o + t*d, pour t dans [0 .. tmax]. invd est l'inverse de la direction du rayon, (1/d.x, 1/d.y, 1/d.z).
+        renvoie vrai si le rayon touche la boite, et tnear, la position de l'entree dans la boite.
+    */
+    bool intersect( const Point& o, const Vector& invd, const float tmax, float& tnear ) const
+    {
+        float t0= 0;
+        float t1= tmax;
+        for(unsigned i= 0; i < 3; i++)
+        {
+            float a= (pmin(i) - o(i)) * invd(i);
+            float b= (pmax(i) - o(i)) * invd(i);
+            // rayon parallele a l'axe, dans le plan d'une face : 0 * inf = NaN. le rayon ne sort pas de la boite sur cet axe
+            if(std::isnan(a) || std::isnan(b))
+                continue;
+
+            t0= std::max(t0, std::min(a, b));
+            t1= std::min(t1, std::max(a, b));
+        }
+
+        tnear= t0;
+        return t0 <= t1;
+    }
+
+    Point pmin, pmax;
+};
+
+
+//! noeud du bvh.
+//! profondeur maximale de l'arbre, limitee par la taille de la pile du parcours, cf BVH::intersect().
+const int BVH_MAX_DEPTH= 60;
+
+struct BVHNode
+{
+    BBox bounds;    //!< englobant du noeud.
+    int first;      //!< noeud interne : indice du premier fils, le second est first+1. feuille : indice du premier objet dans BVH::indices.
+    int count;      //!< feuille : nombre d'objets, 0 pour un noeud interne.
+
+    //! renvoie vrai si le noeud est une feuille.
+    bool leaf( ) const { return count > 0; }
+};
+
+
+/*! hierarchie d'englobants sur un ensemble d'objets quelconques, construite a partir de la boite englobante de chaque objet.
+    les feuilles referencent des intervalles de indices[], qui est une permutation des indices des objets.
+
+    exemple : bvh sur des spheres
+    \code
+    std::vector<BBox> bounds;
+    for(const Sphere& s : spheres)
+        bounds.push_back( BBox(s.c - Vector(s.r, s.r, s.r), s.c + Vector(s.r, s.r, s.r)) );
+
+    BVH bvh;
+    bvh.build(bounds);
+
+    // intersection la plus proche
+    float tmax= inf;
+    int hit= -1;
+    bvh.intersect(o, d, tmax,
+        [&]( const int begin, const int end, float& tmax )
+        {
+            for(int i= begin; i < end; i++)
+            {
+                int id= bvh.indices[i];
+                float t= intersect_sphere(spheres[id].c, spheres[id].r, o, d);
+                if(t < tmax) { tmax= t; hit= id; }
+            }
+            return false;       // continue le parcours
+        });
+    \endcode
+*/
+struct BVH
+{
+    Buffer<BVHNode> nodes;          //!< noeuds, nodes[0] est la racine.
+    Buffer<int> indices;            //!< indices des objets, dans l'ordre des feuilles.
+
+    BVH( ) : nodes(), indices() {}
+
+    /*! construit la hierarchie. bounds[i] est l'englobant de l'objet i.
+        les noeuds sont decoupes en minimisant le cout estime par la SAH (surface area heuristic), evalue sur des intervalles (bins) regulier des centres des englobants.
+        une feuille contient au plus max_leaf objets.
+    */
+    void build( const std::vector<BBox>& bounds, const int max_leaf= 4 );
+
+    //! detruit la hierarchie.
+    void clear( ) { nodes.clear(); indices.clear(); }
+
+    //! renvoie vrai si la hierarchie n'est pas construite, ou ne contient aucun objet.
+    bool empty( ) const { return nodes.empty(); }
+
+    /*! parcourt les feuilles touchees par le rayon o + t*d, t dans [0 .. tmax], de la plus proche a la plus eloignee.
+        leaf(begin, end, tmax) teste les objets indices[begin .. end[, et raccourcit tmax lorsqu'un objet plus proche est touche.
+        le parcours s'arrete des que leaf() renvoie vrai, par exemple pour un rayon d'ombre qui n'a besoin que du premier obstacle.
+        renvoie vrai si le parcours a ete interrompu par leaf().
+    */
+    template < typename Leaf >
+    bool intersect( const Point& o, const Vector& d, float& tmax, Leaf leaf ) const
+    {
+        if(nodes.empty())
+            return false;
+
+        Vector invd= Vector(1 / d.x, 1 / d.y, 1 / d.z);
+
+        // pile des noeuds a visiter, et position de l'entree du rayon dans leur englobant
+        struct Entry { int node; float tnear; };
+        Entry stack[64];
+        int top= 0;
+
+        float tnear;
+        if(!nodes[0].bounds.intersect(o, invd, tmax, tnear))
+            return false;
+        stack[top++]= { 0, tnear };
+
+        while(top > 0)
+        {
+            Entry entry= stack[--top];
+            // le noeud a peut etre ete depasse depuis qu'il a ete empile...
+            if(entry.tnear > tmax)
+                continue;
+
+            const BVHNode& node= nodes[entry.node];
+            if(node.leaf())
+            {
+                if(leaf(node.first, node.first + node.count, tmax))
+                    return true;
+                continue;
+            }
+
+            // visite le fils le plus proche en premier
+            float tleft, tright;
+            bool left= nodes[node.first].bounds.intersect(o, invd, tmax, tleft);
+            bool right= nodes[node.first +1].bounds.intersect(o, invd, tmax, tright);
+            if(left && right)
+            {
+                if(tleft < tright)
+                {
+                    stack[top++]= { node.first +1, tright };
+                    stack[top++]= { node.first, tleft };
+                }
+                else
+                {
+                    stack[top++]= { node.first, tleft };
+                    stack[top++]= { node.first +1, tright };
+                }
+            }
+            else if(left)
+                stack[top++]= { node.first, tleft };
+            else if(right)
+                stack[top++]= { node.first +1, tright };
+        }
+
+        return false;
+    }
+
+protected:
+    void build_node( const int node, const int begin, const int end, const std::vector<BBox>& bounds, const std::vector<Point>& centroids, const int max_leaf, const int depth );
+};
+
+///@}
+#endif
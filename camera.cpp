@@ -0,0 +1,29 @@
+
+#include <cmath>
+
+#include "camera.h"
+
+
+Camera::Camera( const int width, const int height, const Point& from, const Point& to, const Vector& up, const float fov )
+{
+    // le plan near est a distance 1 de la camera : la composante des directions le long de l'axe de visee vaut 1, et t mesure la profondeur, comme pour la camera d'origine
+    Transform view= Lookat(from, to, up);
+    Transform projection= Perspective(fov, float(width) / float(height), 1, 1000);
+    Transform viewport= Viewport(width, height);
+
+    // passage du repere image vers le repere du monde
+    Transform image= Inverse(viewport * projection * view);
+
+    // points du plan near (z= 0 dans le repere image)
+    Point p0= image( Point(0, 0, 0) );
+    Point px= image( Point(1, 0, 0) );
+    Point py= image( Point(0, 1, 0) );
+
+    o= from;
+    d0= Vector(from, p0);
+    dx= Vector(p0, px);
+    dy= Vector(p0, py);
+
+    // angle entre les rayons de 2 lignes voisines, au centre de l'image
+    spread= std::atan(2 * std::tan(radians(fov) / 2) / float(height));
+}
@@ -0,0 +1,64 @@
+
+#ifndef _CAMERA_H
+#define _CAMERA_H
+
+#include "vec.h"
+#include "mat.h"
+#include "scene.h"
+
+
+//! \file
+//! camera perspective, generation des rayons primaires.
+
+//! placement et orientation d'une camera, independants de l'image, cf Camera et read_scene().
+struct View
+{
+    Point from;     //!< position de la camera.
+    Point to;       //!< point observe.
+    Vector up;      //!< direction verticale.
+    float fov;      //!< champ de vision vertical, en degres.
+
+    //! camera par defaut du projet : a l'origine, regarde vers -Z, champ de vision vertical de 90 degres.
+    View( ) : from(0, 0, 0), to(0, 0, -1), up(0, 1, 0), fov(90) {}
+    View( const Point& _from, const Point& _to, const Vector& _up, const float _fov ) : from(_from), to(_to), up(_up), fov(_fov) {}
+};
+
+/*! camera perspective, placee et orientee par Lookat(), avec une projection Perspective() sur une image width x height, cf mat.h.
+    la direction des rayons varie lineairement sur l'image : elle est precalculee pour le pixel (0, 0), et par colonne et par ligne.
+    un rayon ne coute que quelques multiplications et additions, ou seulement 3 additions pour passer au pixel suivant.
+
+    exemple :
+    \code
+    Camera camera(image.width(), image.height(), Point(0, 2, 3), Point(0, 0, -3), Vector(0, 1, 0), 60);
+    for(int py= 0; py < image.height(); py++)
+    for(int px= 0; px < image.width(); px++)
+    {
+        Ray ray= camera.ray(px, py);
+        ...
+    }
+    \endcode
+*/
+struct Camera
+{
+    Point o;        //!< position de la camera, origine des rayons.
+    Vector d0;      //!< direction du rayon du pixel (0, 0).
+    Vector dx;      //!< variation de la direction entre 2 colonnes.
+    Vector dy;      //!< variation de la direction entre 2 lignes.
+    float spread;   //!< angle du cone d'un pixel, pour choisir le niveau de detail des textures : largeur du cone ~ spread * distance, cf ray_cone_lod().
+
+    //! camera par defaut du projet, cf View().
+    Camera( const int width, const int height ) : Camera(width, height, View()) {}
+    //! camera placee et orientee par view.
+    Camera( const int width, const int height, const View& view ) : Camera(width, height, view.from, view.to, view.up, view.fov) {}
+
+    //! camera placee en from, qui regarde le point to. fov : champ de vision vertical, en degres.
+    Camera( const int width, const int height, const Point& from, const Point& to, const Vector& up, const float fov );
+
+    //! direction du rayon passant par le point (x, y) de l'image, les coordonnees ne sont pas forcement entieres, par exemple pour placer plusieurs rayons par pixel.
+    Vector direction( const float x, const float y ) const { return d0 + x * dx + y * dy; }
+
+    //! rayon passant par le point (x, y) de l'image.
+    Ray ray( const float x, const float y ) const { return Ray(o, direction(x, y)); }
+};
+
+#endif
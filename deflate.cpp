@@ -0,0 +1,264 @@
+
+#include <algorithm>
+
+#include "deflate.h"
+
+
+namespace {
+
+// distance maximale d'une copie deflate
+const int WINDOW_SIZE= 32768;
+const int HASH_BITS= 15;
+const int MIN_MATCH= 3;
+const int MAX_MATCH= 258;
+
+const uint32_t ADLER_BASE= 65521;
+
+
+// codes de huffman fixes de deflate, et tables des longueurs / distances des copies
+struct DeflateTables
+{
+    uint16_t literal_code[288];
+    uint8_t literal_bits[288];
+    uint16_t distance_code[30];
+
+    // symbole et bits supplementaires de chaque longueur [3 .. 258] et de chaque distance [1 .. 32768]
+    uint16_t length_symbol[MAX_MATCH +1];
+    uint8_t distance_symbol[512];
+
+    DeflateTables( )
+    {
+        for(int i= 0; i < 288; i++)
+        {
+            int code, bits;
+            if(i < 144)      { code= 0x30 + i; bits= 8; }
+            else if(i < 256) { code= 0x190 + i - 144; bits= 9; }
+            else if(i < 280) { code= i - 256; bits= 7; }
+            else             { code= 0xc0 + i - 280; bits= 8; }
+
+            literal_code[i]= reverse(code, bits);
+            literal_bits[i]= uint8_t(bits);
+        }
+
+        for(int i= 0; i < 30; i++)
+            distance_code[i]= reverse(i, 5);
+
+        for(int i= 0; i < 29; i++)
+            for(int l= length_base[i]; l <= MAX_MATCH && (i == 28 || l < length_base[i +1]); l++)
+                length_symbol[l]= uint16_t(i);
+
+        // distances <= 256 directement, puis par groupes de 128
+        for(int i= 0; i < 30; i++)
+            for(int d= distance_base[i]; d < (i == 29 ? WINDOW_SIZE +1 : distance_base[i +1]); d++)
+            {
+                if(d <= 256)
+                    distance_symbol[d -1]= uint8_t(i);
+                else
+                    distance_symbol[256 + ((d -1) >> 7)]= uint8_t(i);
+            }
+    }
+
+    int distance_index( const int d ) const { return (d <= 256) ? distance_symbol[d -1] : distance_symbol[256 + ((d -1) >> 7)]; }
+
+    static uint16_t reverse( int code, const int bits )
+    {
+        int r= 0;
+        for(int i= 0; i < bits; i++, code>>= 1)
+            r= (r << 1) | (code & 1);
+        return uint16_t(r);
+    }
+
+    static const int length_base[29];
+    static const int length_extra[29];
+    static const int distance_base[30];
+    static const int distance_extra[30];
+};
+
+const int DeflateTables::length_base[29]= { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+const int DeflateTables::length_extra[29]= { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+const int DeflateTables::distance_base[30]= { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+const int DeflateTables::distance_extra[30]= { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+
+const DeflateTables& deflate_tables( )
+{
+    static const DeflateTables tables;
+    return tables;
+}
+
+
+// ecriture d'un flux de bits, poids faibles d'abord, cf deflate
+struct BitWriter
+{
+    std::vector<unsigned char> bytes;
+    uint64_t bits;
+    int count;
+
+    BitWriter( ) : bytes(), bits(0), count(0) {}
+
+    void write( const uint32_t code, const int n )
+    {
+        bits|= uint64_t(code) << count;
+        count+= n;
+        while(count >= 8)
+        {
+            bytes.push_back(uint8_t(bits));
+            bits>>= 8;
+            count-= 8;
+        }
+    }
+
+    void align( )
+    {
+        if(count > 0)
+            write(0, 8 - count);
+    }
+};
+
+inline uint32_t hash3( const unsigned char *p )
+{
+    uint32_t v= (uint32_t(p[0]) << 16) | (uint32_t(p[1]) << 8) | uint32_t(p[2]);
+    return (v * 2654435761u) >> (32 - HASH_BITS);
+}
+
+}
+
+
+uint32_t adler32( const unsigned char *data, const size_t n )
+{
+    uint32_t a= 1;
+    uint32_t b= 0;
+    for(size_t i= 0; i < n; )
+    {
+        // pas de debordement sur 5552 octets
+        size_t end= std::min(n, i + 5552);
+        for(; i < end; i++)
+        {
+            a+= data[i];
+            b+= a;
+        }
+        a%= ADLER_BASE;
+        b%= ADLER_BASE;
+    }
+    return (b << 16) | a;
+}
+
+uint32_t adler32_combine( const uint32_t adler1, const uint32_t adler2, const size_t n2 )
+{
+    uint32_t rem= uint32_t(n2 % ADLER_BASE);
+    uint32_t sum1= adler1 & 0xffff;
+    uint32_t sum2= uint32_t((uint64_t(rem) * sum1) % ADLER_BASE);
+    sum1+= (adler2 & 0xffff) + ADLER_BASE - 1;
+    sum2+= (adler1 >> 16) + (adler2 >> 16) + ADLER_BASE - rem;
+    if(sum1 >= ADLER_BASE) sum1-= ADLER_BASE;
+    if(sum1 >= ADLER_BASE) sum1-= ADLER_BASE;
+    if(sum2 >= (ADLER_BASE << 1)) sum2-= (ADLER_BASE << 1);
+    if(sum2 >= ADLER_BASE) sum2-= ADLER_BASE;
+    return (sum2 << 16) | sum1;
+}
+
+
+std::vector<unsigned char> deflate_block( const unsigned char *data, const int begin, const int end, const bool last, const int max_chain )
+{
+    const DeflateTables& tables= deflate_tables();
+
+    std::vector<int> head(1 << HASH_BITS, -1);
+    std::vector<int> prev(WINDOW_SIZE, -1);
+    auto insert= [&]( const int i )
+    {
+        uint32_t h= hash3(data + i);
+        prev[i & (WINDOW_SIZE -1)]= head[h];
+        head[h]= i;
+    };
+
+    // indexe la fenetre precedente, sans l'encoder
+    for(int i= std::max(0, begin - WINDOW_SIZE); i < begin; i++)
+        if(i + MIN_MATCH <= end)
+            insert(i);
+
+    BitWriter out;
+    out.bytes.reserve((end - begin) / 2 + 64);
+    out.write(last ? 1 : 0, 1);         // dernier bloc ?
+    out.write(1, 2);                    // huffman fixe
+
+    for(int i= begin; i < end; )
+    {
+        int length= 0;
+        int distance= 0;
+        if(i + MIN_MATCH <= end)
+        {
+            // cherche la plus longue copie dans la fenetre
+            const int max_length= std::min(MAX_MATCH, end - i);
+            int candidate= head[hash3(data + i)];
+            for(int chain= 0; candidate >= 0 && chain < max_chain && i - candidate <= WINDOW_SIZE; chain++)
+            {
+                if(data[candidate + length] == data[i + length])
+                {
+                    int l= 0;
+                    while(l < max_length && data[candidate + l] == data[i + l])
+                        l++;
+                    if(l > length)
+                    {
+                        length= l;
+                        distance= i - candidate;
+                        if(l == max_length)
+                            break;
+                    }
+                }
+
+                int next= prev[candidate & (WINDOW_SIZE -1)];
+                if(next >= candidate)
+                    break;      // entree remplacee par une position plus recente
+                candidate= next;
+            }
+            insert(i);
+        }
+
+        if(length >= MIN_MATCH)
+        {
+            int l= tables.length_symbol[length];
+            out.write(tables.literal_code[257 + l], tables.literal_bits[257 + l]);
+            out.write(length - DeflateTables::length_base[l], DeflateTables::length_extra[l]);
+
+            int d= tables.distance_index(distance);
+            out.write(tables.distance_code[d], 5);
+            out.write(distance - DeflateTables::distance_base[d], DeflateTables::distance_extra[d]);
+
+            for(int k= i + 1; k < i + length; k++)
+                if(k + MIN_MATCH <= end)
+                    insert(k);
+            i+= length;
+        }
+        else
+        {
+            out.write(tables.literal_code[data[i]], tables.literal_bits[data[i]]);
+            i++;
+        }
+    }
+
+    out.write(tables.literal_code[256], tables.literal_bits[256]);     // fin du bloc
+    if(!last)
+    {
+        // bloc vide non compresse : len= 0, nlen= ~0
+        out.write(0, 3);
+        out.align();
+        out.write(0x0000, 16);
+        out.write(0xffff, 16);
+    }
+    out.align();
+    return out.bytes;
+}
+
+
+std::vector<unsigned char> zlib_compress( const unsigned char *data, const int n, const int max_chain )
+{
+    std::vector<unsigned char> out= { 0x78, 0x01 };
+    std::vector<unsigned char> block= deflate_block(data, 0, n, true, max_chain);
+    out.insert(out.end(), block.begin(), block.end());
+
+    uint32_t adler= adler32(data, n);
+    out.push_back(uint8_t(adler >> 24));
+    out.push_back(uint8_t(adler >> 16));
+    out.push_back(uint8_t(adler >> 8));
+    out.push_back(uint8_t(adler));
+    return out;
+}
@@ -0,0 +1,32 @@
+
+#ifndef _DEFLATE_H
+#define _DEFLATE_H
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+
+//! \file
+//! compression deflate / zlib, pour les images .png et .exr. les donnees peuvent etre decoupees en blocs compresses en parallele, puis concatenes.
+
+//! nombre de copies testees pour chaque octet : rapide, ou par defaut, plus compact.
+const int DEFLATE_FAST= 1;
+const int DEFLATE_DEFAULT= 32;
+
+/*! compresse data[begin .. end[ dans un bloc deflate, codes de huffman fixes, et renvoie les octets du bloc.
+    les copies peuvent referencer les 32Ko qui precedent begin, comme si les blocs precedents avaient ete compresses par le meme compresseur.
+    si last est faux, le bloc est termine par un bloc vide non compresse, aligne sur un octet (sync flush) : les blocs compresses en parallele peuvent etre concatenes.
+    max_chain, nombre de copies testees pour chaque octet, cf DEFLATE_FAST et DEFLATE_DEFAULT.
+*/
+std::vector<unsigned char> deflate_block( const unsigned char *data, const int begin, const int end, const bool last, const int max_chain= DEFLATE_DEFAULT );
+
+//! compresse n octets dans un flux zlib complet : entete, un seul bloc deflate, adler32.
+std::vector<unsigned char> zlib_compress( const unsigned char *data, const int n, const int max_chain= DEFLATE_DEFAULT );
+
+//! adler32 de n octets, cf zlib.
+uint32_t adler32( const unsigned char *data, const size_t n );
+//! adler32 de la concatenation de 2 sequences, connaissant leurs adler32 et la taille de la 2ieme, cf adler32_combine() de zlib.
+uint32_t adler32_combine( const uint32_t adler1, const uint32_t adler2, const size_t n2 );
+
+#endif
@@ -0,0 +1,251 @@
+
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <vector>
+
+#include "exr_writer.h"
+#include "deflate.h"
+#include "half.h"
+
+
+namespace {
+
+// region de l'image compressee independamment : tuile ou groupe de lignes, pixels [x0 .. x1[ x [y0 .. y1[.
+struct Chunk
+{
+    int x0, y0;
+    int x1, y1;
+    int tx, ty;     // indice de la tuile
+};
+
+// valeurs little endian
+void write_u8( std::vector<unsigned char>& out, const uint8_t v ) { out.push_back(v); }
+
+void write_u32( std::vector<unsigned char>& out, const uint32_t v )
+{
+    for(int i= 0; i < 4; i++)
+        out.push_back(uint8_t(v >> (8*i)));
+}
+
+void write_u64( std::vector<unsigned char>& out, const uint64_t v )
+{
+    for(int i= 0; i < 8; i++)
+        out.push_back(uint8_t(v >> (8*i)));
+}
+
+void write_i32( std::vector<unsigned char>& out, const int v ) { write_u32(out, uint32_t(v)); }
+
+void write_f32( std::vector<unsigned char>& out, const float v )
+{
+    uint32_t x;
+    std::memcpy(&x, &v, 4);
+    write_u32(out, x);
+}
+
+void write_string( std::vector<unsigned char>& out, const char *s )
+{
+    out.insert(out.end(), s, s + strlen(s) +1);
+}
+
+// attribut de l'entete : nom, type, taille, valeur
+void write_attribute( std::vector<unsigned char>& out, const char *name, const char *type, const std::vector<unsigned char>& value )
+{
+    write_string(out, name);
+    write_string(out, type);
+    write_i32(out, int(value.size()));
+    out.insert(out.end(), value.begin(), value.end());
+}
+
+void write_box( std::vector<unsigned char>& out, const int xmin, const int ymin, const int xmax, const int ymax )
+{
+    write_i32(out, xmin);
+    write_i32(out, ymin);
+    write_i32(out, xmax);
+    write_i32(out, ymax);
+}
+
+/* pixels d'une region, ligne par ligne, et pour chaque ligne, les composantes dans l'ordre des canaux, b, g, r, en half float.
+    compression zip : les octets sont separes (poids faibles, puis poids forts), puis remplaces par leur difference avec le precedent, et compresses, cf openexr.
+    les donnees restent non compressees si la compression n'est pas plus petite.
+ */
+std::vector<unsigned char> encode_chunk( const float *pixels, const int width, const int height, const Chunk& chunk, const bool flipY, const EXRCompression compression )
+{
+    const int w= chunk.x1 - chunk.x0;
+    const int h= chunk.y1 - chunk.y0;
+    std::vector<unsigned char> raw(size_t(w) * h * 3 * 2);
+
+    std::vector<float> line(w);
+    std::vector<uint16_t> halfs(w);
+    unsigned char *p= raw.data();
+    for(int y= chunk.y0; y < chunk.y1; y++)
+    {
+        int source= flipY ? height -1 - y : y;
+        const float *row= pixels + (size_t(source) * width + chunk.x0) * 4;
+        for(int c= 2; c >= 0; c--)
+        {
+            for(int x= 0; x < w; x++)
+                line[x]= row[4*x + c];
+            float_to_half(line.data(), halfs.data(), w);
+
+            for(int x= 0; x < w; x++, p+= 2)
+            {
+                p[0]= uint8_t(halfs[x]);
+                p[1]= uint8_t(halfs[x] >> 8);
+            }
+        }
+    }
+
+    if(compression == EXR_NONE)
+        return raw;
+
+    const size_t n= raw.size();
+    std::vector<unsigned char> tmp(n);
+    for(size_t i= 0; i < n; i+= 2)
+    {
+        tmp[i / 2]= raw[i];
+        if(i + 1 < n)
+            tmp[(n + 1) / 2 + i / 2]= raw[i + 1];
+    }
+
+    for(size_t i= n -1; i > 0; i--)
+        tmp[i]= uint8_t(int(tmp[i]) - int(tmp[i -1]) + 128);
+
+    std::vector<unsigned char> compressed= zlib_compress(tmp.data(), int(n), DEFLATE_FAST);
+    if(compressed.size() >= raw.size())
+        return raw;
+    return compressed;
+}
+
+}
+
+
+bool write_exr( const float *pixels, const int width, const int height, const char *filename, const bool flipY, const int tile, const EXRCompression compression )
+{
+    if(width <= 0 || height <= 0)
+        return false;
+
+    // decoupe l'image : tuiles, ligne par ligne, ou groupes de lignes, 16 lignes pour zip, 1 ligne sinon
+    std::vector<Chunk> chunks;
+    if(tile > 0)
+    {
+        for(int ty= 0; ty * tile < height; ty++)
+        for(int tx= 0; tx * tile < width; tx++)
+            chunks.push_back( { tx * tile, ty * tile, std::min(width, (tx+1) * tile), std::min(height, (ty+1) * tile), tx, ty } );
+    }
+    else
+    {
+        const int lines= (compression == EXR_ZIP) ? 16 : 1;
+        for(int y= 0; y < height; y+= lines)
+            chunks.push_back( { 0, y, width, std::min(height, y + lines), 0, 0 } );
+    }
+
+    // convertit et compresse les regions, en parallele
+    const int n= int(chunks.size());
+    std::vector< std::vector<unsigned char> > blocks(n);
+    #pragma omp parallel for schedule(dynamic, 1)
+    for(int i= 0; i < n; i++)
+        blocks[i]= encode_chunk(pixels, width, height, chunks[i], flipY, compression);
+
+    // entete
+    std::vector<unsigned char> header;
+    write_u32(header, 20000630);                        // magic
+    write_u32(header, 2 | (tile > 0 ? 0x200 : 0));      // version 2, tuiles
+
+    std::vector<unsigned char> value;
+    for(const char *channel : { "B", "G", "R" })
+    {
+        write_string(value, channel);
+        write_i32(value, 1);            // half
+        write_u8(value, 0);             // pLinear
+        write_u8(value, 0);
+        write_u8(value, 0);
+        write_u8(value, 0);
+        write_i32(value, 1);            // xSampling
+        write_i32(value, 1);            // ySampling
+    }
+    write_u8(value, 0);
+    write_attribute(header, "channels", "chlist", value);
+
+    value.clear();
+    write_u8(value, uint8_t(compression));
+    write_attribute(header, "compression", "compression", value);
+
+    value.clear();
+    write_box(value, 0, 0, width -1, height -1);
+    write_attribute(header, "dataWindow", "box2i", value);
+    write_attribute(header, "displayWindow", "box2i", value);
+
+    value.clear();
+    write_u8(value, 0);                 // INCREASING_Y
+    write_attribute(header, "lineOrder", "lineOrder", value);
+
+    value.clear();
+    write_f32(value, 1);
+    write_attribute(header, "pixelAspectRatio", "float", value);
+
+    value.clear();
+    write_f32(value, 0);
+    write_f32(value, 0);
+    write_attribute(header, "screenWindowCenter", "v2f", value);
+
+    value.clear();
+    write_f32(value, 1);
+    write_attribute(header, "screenWindowWidth", "float", value);
+
+    if(tile > 0)
+    {
+        value.clear();
+        write_u32(value, uint32_t(tile));
+        write_u32(value, uint32_t(tile));
+        write_u8(value, 0);             // ONE_LEVEL, ROUND_DOWN
+        write_attribute(header, "tiles", "tiledesc", value);
+    }
+    write_u8(header, 0);
+
+    // table des positions des regions dans le fichier, puis les regions : indice de la tuile ou premiere ligne, taille et donnees
+    std::vector<unsigned char> table;
+    uint64_t offset= header.size() + 8 * uint64_t(n);
+    std::vector< std::vector<unsigned char> > prefixes(n);
+    for(int i= 0; i < n; i++)
+    {
+        write_u64(table, offset);
+
+        if(tile > 0)
+        {
+            write_i32(prefixes[i], chunks[i].tx);
+            write_i32(prefixes[i], chunks[i].ty);
+            write_i32(prefixes[i], 0);  // niveau
+            write_i32(prefixes[i], 0);
+        }
+        else
+            write_i32(prefixes[i], chunks[i].y0);
+        write_i32(prefixes[i], int(blocks[i].size()));
+
+        offset+= prefixes[i].size() + blocks[i].size();
+    }
+
+    FILE *out= fopen(filename, "wb");
+    if(!out)
+    {
+        printf("[error] writing exr '%s'...\n", filename);
+        return false;
+    }
+
+    bool code= fwrite(header.data(), 1, header.size(), out) == header.size();
+    code= code && fwrite(table.data(), 1, table.size(), out) == table.size();
+    for(int i= 0; i < n && code; i++)
+    {
+        code= fwrite(prefixes[i].data(), 1, prefixes[i].size(), out) == prefixes[i].size();
+        code= code && (blocks[i].empty() || fwrite(blocks[i].data(), 1, blocks[i].size(), out) == blocks[i].size());
+    }
+
+    if(fclose(out) != 0 || !code)
+    {
+        printf("[error] writing exr '%s'...\n", filename);
+        return false;
+    }
+
+    return true;
+}
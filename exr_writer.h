@@ -0,0 +1,26 @@
+
+#ifndef _EXR_WRITER_H
+#define _EXR_WRITER_H
+
+
+//! \addtogroup image
+///@{
+
+//! \file
+//! ecriture parallele d'images .exr (openexr) : composantes r, g, b en half float, decoupees en tuiles ou en groupes de lignes, compressees independamment.
+
+//! compression des images .exr : aucune, ou zip, deflate de chaque tuile ou de chaque groupe de 16 lignes.
+enum EXRCompression
+{
+    EXR_NONE= 0,
+    EXR_ZIP= 3
+};
+
+/*! enregistre les composantes r, g, b d'une image float rgba, 4 floats par pixel, cf Image::data(), width x height pixels, au format .exr, en half float, cf float_to_half().
+    tile > 0 : l'image est decoupee en tuiles tile x tile, sinon en groupes de lignes. les tuiles (ou les groupes de lignes) sont converties et compressees en parallele.
+    alpha n'est pas enregistre.
+*/
+bool write_exr( const float *pixels, const int width, const int height, const char *filename, const bool flipY= true, const int tile= 64, const EXRCompression compression= EXR_ZIP );
+
+///@}
+#endif
@@ -0,0 +1,106 @@
+
+#ifndef _FAST_MATH_H
+#define _FAST_MATH_H
+
+#include <algorithm>
+
+#include "color.h"
+#include "simd.h"
+
+
+//! \addtogroup math
+///@{
+
+//! \file
+//! log2, exp2 et pow approches, sur des groupes de SIMD_WIDTH floats, pour les transformations gamma des images.
+
+/*! log2(x), pour x > 0 normalise (x >= FLT_MIN).
+    la mantisse est ramenee dans [sqrt(1/2) .. sqrt(2)[ et log2(m)= 2/ln(2) * atanh((m-1) / (m+1)), serie a l'ordre 9.
+    erreur < 1.2e-7 * max(1, |log2(x)|).
+*/
+inline vfloat vlog2( const vfloat x )
+{
+    vfloat e;
+    vfloat m= vmantissa(x, e);
+    vbool grand= m > vfloat(1.41421356f);
+    m= vselect(grand, m * vfloat(0.5f), m);
+    e= vselect(grand, e + vfloat(1.f), e);
+
+    vfloat s= (m - vfloat(1.f)) / (m + vfloat(1.f));
+    vfloat s2= s * s;
+    vfloat p= vfloat(1.f / 9.f);
+    p= p * s2 + vfloat(1.f / 7.f);
+    p= p * s2 + vfloat(1.f / 5.f);
+    p= p * s2 + vfloat(1.f / 3.f);
+    p= p * s2 + vfloat(1.f);
+    return e + vfloat(2.88539008f) * s * p;
+}
+
+/*! 2^x, x est limite a [-126 .. 127].
+    x= i + f, i entier, f dans [-1/2 .. 1/2] et 2^f= exp(f * ln(2)), serie de taylor a l'ordre 7.
+    erreur relative < 1e-7.
+*/
+inline vfloat vexp2( const vfloat x )
+{
+    vfloat t= vmin(vmax(x, vfloat(-126.f)), vfloat(127.f));
+    vfloat i= vfloor(t + vfloat(0.5f));
+    vfloat f= t - i;
+
+    vfloat p= vfloat(1.52527338e-5f);
+    p= p * f + vfloat(1.54035304e-4f);
+    p= p * f + vfloat(1.33335581e-3f);
+    p= p * f + vfloat(9.61812911e-3f);
+    p= p * f + vfloat(5.55041087e-2f);
+    p= p * f + vfloat(2.40226507e-1f);
+    p= p * f + vfloat(6.93147181e-1f);
+    p= p * f + vfloat(1.f);
+    return vldexp(p, i);
+}
+
+/*! x^y, calcule comme 2^(y * log2(x)). renvoie 0 si x <= 0, et nan si x est nan.
+    erreur relative < 1.2e-7 * (1 + |y * log2(x)|), si le resultat est un float normalise. pour une transformation gamma de [0 .. 1] vers 8 bits,
+    le resultat differe d'au plus 1 niveau de celui de std::pow(), pour moins de 2 valeurs sur un million.
+*/
+inline vfloat vpow( const vfloat x, const vfloat y )
+{
+    vfloat r= vexp2(y * vlog2(x));
+    return vselect(x > vfloat(0.f), r, vselect(x <= vfloat(0.f), vfloat(0.f), x));
+}
+
+/*! remplace les composantes r, g, b des n couleurs par k * c^g, cf vpow(). alpha n'est pas modifie.
+    les couleurs sont transformees par groupes de SIMD_WIDTH.
+*/
+inline void pow_colors( Color *colors, const int n, const float g, const float k= 1 )
+{
+    const vfloat vg= vfloat(g);
+    const vfloat vk= vfloat(k);
+    for(int i= 0; i < n; i+= SIMD_WIDTH)
+    {
+        // regroupe les composantes, le dernier groupe est complete avec la derniere couleur
+        const int m= std::min(SIMD_WIDTH, n - i);
+        float r[SIMD_WIDTH];
+        float v[SIMD_WIDTH];
+        float b[SIMD_WIDTH];
+        for(int j= 0; j < SIMD_WIDTH; j++)
+        {
+            const Color& color= colors[i + std::min(j, m -1)];
+            r[j]= color.r;
+            v[j]= color.g;
+            b[j]= color.b;
+        }
+
+        vstore(r, vk * vpow(vload(r), vg));
+        vstore(v, vk * vpow(vload(v), vg));
+        vstore(b, vk * vpow(vload(b), vg));
+
+        for(int j= 0; j < m; j++)
+        {
+            colors[i + j].r= r[j];
+            colors[i + j].g= v[j];
+            colors[i + j].b= b[j];
+        }
+    }
+}
+
+///@}
+#endif
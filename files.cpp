@@ -6,6 +6,8 @@
     #include <sys/stat.h>
 #endif
 
+#include <cstdio>
+#include <cstdint>
 #include <string>
 #include <algorithm>
 
@@ -58,6 +60,29 @@ size_t timestamp( const std::string& filename )
     return 0;
 }
 
+//! renvoie la taille d'un fichier, en octets, ou 0.
+size_t file_size( const std::string& filename )
+{
+#ifndef _MSC_VER
+    struct stat info;
+    if(stat(filename.c_str(), &info) < 0)
+        return 0;
+
+    if(S_ISREG(info.st_mode))
+        return size_t(info.st_size);
+
+#else
+    struct _stat64 info;
+    if(_stat64(filename.c_str(), &info) < 0)
+        return 0;
+
+    if(info.st_mode & _S_IFREG)
+        return size_t(info.st_size);
+#endif
+
+    return 0;
+}
+
 
 /*! renvoie le chemin d'acces a un fichier. le chemin est toujours termine par /
     pathname("path\to\file") == "path/to/"
@@ -122,3 +147,32 @@ std::string absolute_filename( const std::string& path, const std::string& filen
     else
         return normalize_filename(path + filename);
 }
+
+
+namespace {
+
+// hash fnv-1a du chemin d'un fichier
+uint64_t hash( const std::string& s )
+{
+    uint64_t h= 0xcbf29ce484222325ull;
+    for(unsigned char c : s)
+        h= (h ^ c) * 0x100000001b3ull;
+    return h;
+}
+
+}
+
+std::string cache_filename( const std::string& filename, const std::string& directory, const char *extension )
+{
+    if(directory.empty())
+        return filename + extension;
+
+    // plusieurs fichiers de meme nom, dans des repertoires differents, partagent le repertoire du cache : le nom du cache depend du chemin complet
+    std::string name= relative_filename(filename, pathname(filename));
+    std::string::size_type dot= name.rfind('.');
+    char key[32];
+    snprintf(key, sizeof(key), "-%016llx", (unsigned long long) hash(normalize_filename(filename)));
+    name.insert(dot == std::string::npos ? name.size() : dot, key);
+
+    return normalize_filename(directory + "/" + name + extension);
+}
@@ -10,6 +10,9 @@ bool exists( const std::string& filename );
 //! renvoie la date de la derniere modification d'un fichier
 size_t timestamp( const std::string& filename );
 
+//! renvoie la taille d'un fichier, en octets, ou 0.
+size_t file_size( const std::string& filename );
+
 /*! renvoie le chemin d'acces a un fichier. le chemin est toujours termine par /
     pathname("path\to\file") == "path/to/"
     pathname("path\to/file") == "path/to/"
@@ -29,4 +32,11 @@ std::string relative_filename( const std::string& filename, const std::string& p
 
 std::string absolute_filename( const std::string& path, const std::string& filename );
 
+/*! renvoie le nom du fichier cache d'un fichier : "objet.obj<extension>", a cote du fichier, 
+    ou "objet-<hash>.obj<extension>" dans le repertoire directory, s'il n'est pas vide. le hash du chemin complet distingue les fichiers de meme nom.
+    cache_filename("data/robot.obj", "", ".cache") == "data/robot.obj.cache"
+    cache_filename("data/robot.obj", "tmp", ".cache") == "tmp/robot-<hash>.obj.cache"
+*/
+std::string cache_filename( const std::string& filename, const std::string& directory, const char *extension );
+
 #endif
@@ -0,0 +1,100 @@
+
+#ifndef _HALF_H
+#define _HALF_H
+
+#include <cstdint>
+#include <cstring>
+
+#if defined(__F16C__)
+#include <immintrin.h>
+#endif
+
+
+//! \addtogroup math
+///@{
+
+//! \file
+//! conversion float / half float (ieee 754, 16 bits), pour les images hdr.
+
+/*! convertit un float en half, arrondi au plus proche (pair en cas d'egalite), comme les instructions f16c.
+    les valeurs trop grandes deviennent +/- inf, les nan restent des nan.
+*/
+inline uint16_t float_to_half( const float f )
+{
+    uint32_t x;
+    std::memcpy(&x, &f, 4);
+    uint32_t sign= (x >> 16) & 0x8000;
+    x&= 0x7fffffff;
+
+    if(x >= 0x7f800000)
+        // inf ou nan
+        return uint16_t(sign | 0x7c00 | ((x > 0x7f800000) ? (0x200 | ((x >> 13) & 0x3ff)) : 0));
+    if(x >= 0x477ff000)
+        // >= 65520, arrondi a inf
+        return uint16_t(sign | 0x7c00);
+
+    if(x < 0x38800000)
+    {
+        // < 2^-14 : denormalise ou 0
+        if(x <= 0x33000000)
+            return uint16_t(sign);
+
+        int e= x >> 23;
+        uint32_t m= (x & 0x7fffff) | 0x800000;
+        int shift= 126 - e;
+        uint32_t h= m >> shift;
+        uint32_t r= m & ((1u << shift) -1);
+        uint32_t middle= 1u << (shift -1);
+        if(r > middle || (r == middle && (h & 1)))
+            h++;
+        return uint16_t(sign | h);
+    }
+
+    // normalise : change le biais de l'exposant et arrondit la mantisse, la retenue peut incrementer l'exposant
+    uint32_t h= (x - 0x38000000) >> 13;
+    uint32_t r= x & 0x1fff;
+    if(r > 0x1000 || (r == 0x1000 && (h & 1)))
+        h++;
+    return uint16_t(sign | h);
+}
+
+//! convertit un half en float, sans erreur.
+inline float half_to_float( const uint16_t h )
+{
+    uint32_t sign= uint32_t(h & 0x8000) << 16;
+    uint32_t e= (h >> 10) & 0x1f;
+    uint32_t m= h & 0x3ff;
+
+    uint32_t x;
+    if(e == 0)
+    {
+        // denormalise : m * 2^-24
+        float f= float(m) * 5.9604644775390625e-8f;
+        std::memcpy(&x, &f, 4);
+        x|= sign;
+    }
+    else if(e == 31)
+        // inf ou nan, toujours silencieux
+        x= sign | 0x7f800000 | (m << 13) | (m ? 0x400000 : 0);
+    else
+        x= sign | ((e + 112) << 23) | (m << 13);
+
+    float f;
+    std::memcpy(&f, &x, 4);
+    return f;
+}
+
+//! convertit n floats en half, par groupes de 8 avec f16c, sinon un par un, meme resultat que float_to_half().
+inline void float_to_half( const float *in, uint16_t *out, const int n )
+{
+    int i= 0;
+#if defined(__F16C__)
+    for(; i + 8 <= n; i+= 8)
+        _mm_storeu_si128((__m128i *) (out + i), _mm256_cvtps_ph(_mm256_loadu_ps(in + i), _MM_FROUND_TO_NEAREST_INT));
+#endif
+    for(; i < n; i++)
+        out[i]= float_to_half(in[i]);
+}
+
+///@}
+#endif
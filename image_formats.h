@@ -0,0 +1,264 @@
+
+#ifndef _IMAGE_FORMATS_H
+#define _IMAGE_FORMATS_H
+
+#include <cmath>
+#include <cassert>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "color.h"
+#include "image.h"
+#include "half.h"
+
+
+//! \addtogroup image
+///@{
+
+//! \file
+//! images compactes : pixels stockes en 8 bits ou en half float, convertis en Color a la lecture, pour les textures.
+
+//! pixel rgb 8 bits, valeurs [0 .. 255] pour [0 .. 1], alpha = 1. 3 octets au lieu des 16 d'une Color.
+struct RGB8
+{
+    uint8_t r, g, b;
+
+    RGB8( ) : r(0), g(0), b(0) {}
+    RGB8( const uint8_t _r, const uint8_t _g, const uint8_t _b ) : r(_r), g(_g), b(_b) {}
+    //! arrondi au plus proche, les valeurs en dehors de [0 .. 1] sont saturees.
+    explicit RGB8( const Color& color ) : r(unorm8(color.r)), g(unorm8(color.g)), b(unorm8(color.b)) {}
+
+    Color color( ) const { return Color(float(r) * (1 / float(255)), float(g) * (1 / float(255)), float(b) * (1 / float(255))); }
+
+    static uint8_t unorm8( const float x )
+    {
+        if(!(x > 0)) return 0;      // et nan
+        if(x >= 1) return 255;
+        return uint8_t(x * 255 + float(0.5));
+    }
+};
+
+//! pixel rgba 8 bits, valeurs [0 .. 255] pour [0 .. 1]. 4 octets au lieu des 16 d'une Color.
+struct RGBA8
+{
+    uint8_t r, g, b, a;
+
+    RGBA8( ) : r(0), g(0), b(0), a(255) {}
+    RGBA8( const uint8_t _r, const uint8_t _g, const uint8_t _b, const uint8_t _a= 255 ) : r(_r), g(_g), b(_b), a(_a) {}
+    //! arrondi au plus proche, les valeurs en dehors de [0 .. 1] sont saturees.
+    explicit RGBA8( const Color& color ) : r(RGB8::unorm8(color.r)), g(RGB8::unorm8(color.g)), b(RGB8::unorm8(color.b)), a(RGB8::unorm8(color.a)) {}
+
+    Color color( ) const { return Color(float(r) * (1 / float(255)), float(g) * (1 / float(255)), float(b) * (1 / float(255)), float(a) * (1 / float(255))); }
+};
+
+//! pixel rgb half float, pour les images hdr ou lineaires, alpha = 1. 6 octets au lieu des 16 d'une Color, cf float_to_half().
+struct RGB16F
+{
+    uint16_t r, g, b;
+
+    RGB16F( ) : r(0), g(0), b(0) {}
+    explicit RGB16F( const Color& color ) : r(float_to_half(color.r)), g(float_to_half(color.g)), b(float_to_half(color.b)) {}
+
+    Color color( ) const { return Color(half_to_float(r), half_to_float(g), half_to_float(b)); }
+};
+
+//! pixel rgb float, sans perte pour les composantes r, g, b, alpha = 1. 12 octets au lieu des 16 d'une Color.
+struct RGB32F
+{
+    float r, g, b;
+
+    RGB32F( ) : r(0), g(0), b(0) {}
+    explicit RGB32F( const Color& color ) : r(color.r), g(color.g), b(color.b) {}
+
+    Color color( ) const { return Color(r, g, b); }
+};
+
+// les pixels ont la meme organisation que les images chargees par stbi, 3 ou 4 composantes, cf ImageT( w, h, data, owner )
+static_assert(sizeof(RGB8) == 3 && sizeof(RGBA8) == 4 && sizeof(RGB16F) == 6 && sizeof(RGB32F) == 12, "pixel padding");
+
+
+/*! image stockee dans un format compact, cf RGB8, RGBA8, RGB16F, RGB32F.
+    meme interface de lecture que Image : les pixels sont convertis en Color a la demande, par sample() et texture() notamment.
+    l'image peut aussi adopter des pixels alloues ailleurs, par exemple directement l'image decodee par stbi, sans copie, cf ImageT( w, h, data, owner ).
+    \code
+    ImageRGBA8 texture= read_image_rgba8("data/texture.png");   // 4 octets par pixel
+    Color color= texture.texture(u, v);
+    \endcode
+*/
+template < typename Pixel >
+class ImageT
+{
+protected:
+    std::vector<Pixel> m_vector;        // pixels alloues par l'image
+    Pixel *m_data;                      // pixels, dans m_vector, ou adoptes, dans la memoire de m_owner
+    size_t m_size;
+    std::shared_ptr<void> m_owner;      // libere les pixels adoptes, cf ImageT( w, h, data, owner )
+    int m_width;
+    int m_height;
+
+public:
+    ImageT( ) : m_vector(), m_data(nullptr), m_size(0), m_owner(), m_width(0), m_height(0) {}
+    ImageT( const int w, const int h, const Pixel& pixel= Pixel() ) : m_vector(size_t(w)*h, pixel), m_data(m_vector.data()), m_size(m_vector.size()), m_owner(), m_width(w), m_height(h) {}
+
+    /*! adopte les w x h pixels stockes en data, sans les copier : l'image les modifie directement, et owner les libere avec l'image.
+        une copie de l'image copie les pixels, comme pour une image ordinaire.
+    */
+    ImageT( const int w, const int h, Pixel *data, const std::shared_ptr<void>& owner ) : m_vector(), m_data(data), m_size(size_t(w)*h), m_owner(owner), m_width(w), m_height(h) {}
+
+    ImageT( const ImageT& b ) : m_vector(b.m_data, b.m_data + b.m_size), m_data(m_vector.data()), m_size(b.m_size), m_owner(), m_width(b.m_width), m_height(b.m_height) {}
+    ImageT& operator= ( const ImageT& b )
+    {
+        if(this != &b)
+        {
+            m_vector.assign(b.m_data, b.m_data + b.m_size);
+            m_owner.reset();
+            m_data= m_vector.data();
+            m_size= b.m_size;
+            m_width= b.m_width;
+            m_height= b.m_height;
+        }
+        return *this;
+    }
+
+    // les pixels d'un std::vector ne changent pas de place lorsqu'il est deplace.
+    // noexcept : un std::vector< ImageT > deplace ses images lorsqu'il grandit, au lieu de les copier, et les pixels adoptes restent adoptes, cf MipmapT.
+    ImageT( ImageT&& b ) noexcept : m_vector(std::move(b.m_vector)), m_data(b.m_data), m_size(b.m_size), m_owner(std::move(b.m_owner)), m_width(b.m_width), m_height(b.m_height) { b.reset(); }
+    ImageT& operator= ( ImageT&& b ) noexcept
+    {
+        if(this != &b)
+        {
+            m_vector= std::move(b.m_vector);
+            m_owner= std::move(b.m_owner);
+            m_data= b.m_data;
+            m_size= b.m_size;
+            m_width= b.m_width;
+            m_height= b.m_height;
+            b.reset();
+        }
+        return *this;
+    }
+
+    //! convertit une image, les pixels sont arrondis au format compact, en parallele.
+    explicit ImageT( const Image& image ) : m_vector(image.size()), m_data(m_vector.data()), m_size(m_vector.size()), m_owner(), m_width(image.width()), m_height(image.height())
+    {
+        const int n= int(m_size);
+        #pragma omp parallel for schedule(static)
+        for(int i= 0; i < n; i++)
+            m_data[i]= Pixel(image(size_t(i)));
+    }
+
+    //! renvoie une image float, en parallele.
+    Image image( ) const
+    {
+        Image tmp(m_width, m_height);
+        const int n= int(m_size);
+        #pragma omp parallel for schedule(static)
+        for(int i= 0; i < n; i++)
+            tmp(size_t(i))= m_data[i].color();
+        return tmp;
+    }
+
+    //! renvoie une reference sur le pixel (x, y), dans son format compact.
+    Pixel& operator() ( const int x, const int y ) { return m_data[offset(x, y)]; }
+    //! renvoie le pixel (x, y), dans son format compact.
+    const Pixel& operator() ( const int x, const int y ) const { return m_data[offset(x, y)]; }
+
+    //! renvoie une reference sur le ieme pixel de l'image.
+    Pixel& operator() ( const size_t offset )
+    {
+        assert(offset < m_size);
+        return m_data[offset];
+    }
+
+    //! renvoie le ieme pixel de l'image.
+    const Pixel& operator() ( const size_t offset ) const
+    {
+        assert(offset < m_size);
+        return m_data[offset];
+    }
+
+    //! renvoie la couleur du pixel (x, y).
+    Color color( const int x, const int y ) const { return m_data[offset(x, y)].color(); }
+
+    //! renvoie la couleur interpolee a la position (x, y) [0 .. width]x[0 .. height], cf Image::sample().
+    Color sample( const float x, const float y ) const
+    {
+        // interpolation bilineaire, les pixels en dehors de l'image sont ceux du bord
+        float fx= std::floor(x);
+        float fy= std::floor(y);
+        float u= x - fx;
+        float v= y - fy;
+        int ix= int(fx);
+        int iy= int(fy);
+        return color(ix, iy)    * ((1 - u) * (1 - v))
+            + color(ix+1, iy)   * (u       * (1 - v))
+            + color(ix, iy+1)   * ((1 - u) * v)
+            + color(ix+1, iy+1) * (u       * v);
+    }
+
+    //! renvoie la couleur interpolee aux coordonnees normalisees (x, y) [0 .. 1]x[0 .. 1].
+    Color texture( const float x, const float y ) const
+    {
+        return sample(x * m_width, y * m_height);
+    }
+
+    //! renvoie un const pointeur sur le stockage des pixels.
+    const Pixel *data( ) const
+    {
+        assert(m_size > 0);
+        return m_data;
+    }
+
+    //! renvoie un pointeur sur le stockage des pixels.
+    Pixel *data( )
+    {
+        assert(m_size > 0);
+        return m_data;
+    }
+
+    //! renvoie la largeur de l'image.
+    int width( ) const { return m_width; }
+    //! renvoie la hauteur de l'image.
+    int height( ) const { return m_height; }
+    //! renvoie le nombre de pixels de l'image.
+    unsigned size( ) const { return m_width * m_height; }
+    //! renvoie vrai si les pixels ont ete adoptes, cf ImageT( w, h, data, owner ).
+    bool adopted( ) const { return bool(m_owner); }
+    //! renvoie la taille des pixels, en octets.
+    size_t bytes( ) const { return m_size * sizeof(Pixel); }
+
+    //! renvoie l'indice du pixel (x, y), ou du pixel le plus proche si (x, y) est en dehors de l'image, cf Image::offset().
+    unsigned offset( const int x, const int y ) const
+    {
+        int px= x;
+        if(px < 0) px= 0;
+        if(px > m_width-1) px= m_width-1;
+        int py= y;
+        if(py < 0) py= 0;
+        if(py > m_height-1) py= m_height-1;
+
+        unsigned p= py * m_width + px;
+        assert(p < m_size);
+        return p;
+    }
+
+protected:
+    void reset( )
+    {
+        m_vector.clear();
+        m_data= nullptr;
+        m_size= 0;
+        m_owner.reset();
+        m_width= 0;
+        m_height= 0;
+    }
+};
+
+typedef ImageT<RGB8> ImageRGB8;
+typedef ImageT<RGBA8> ImageRGBA8;
+typedef ImageT<RGB16F> ImageRGB16F;
+typedef ImageT<RGB32F> ImageRGB32F;
+
+///@}
+#endif
@@ -1,7 +1,13 @@
 
 #include <cfloat>
+#include <cstring>
+#include <memory>
+#include <type_traits>
 
 #include "image.h"
+#include "image_io.h"
+#include "fast_math.h"
+#include "qoi.h"
 
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
@@ -10,101 +16,242 @@
 #include "stb_image_write.h"
 
 
-Color gamma( const Color& color, const float g )
+// nombre de pixels transformes par un thread a la fois
+const int PIXEL_BLOCK= 1024;
+
+// remplace les composantes r, g, b des pixels par k * c^g, par blocs de pixels, en parallele. cf pow_colors()
+static void pow_image( Image& image, const float g, const float k= 1 )
 {
-    return Color(std::pow(color.r, g), std::pow(color.g, g), std::pow(color.b, g), color.a);
+    const int n= int(image.size());
+    #pragma omp parallel for schedule(static)
+    for(int i= 0; i < n; i+= PIXEL_BLOCK)
+        pow_colors(&image(size_t(i)), std::min(PIXEL_BLOCK, n - i), g, k);
 }
 
 
-Image gamma( const Image& image, const float g= float(2.2) )
+Image gamma( const Image& image, const float g )
 {
-    Image tmp(image.width(), image.height());
-    
-    float invg= 1 / g;
-    for(unsigned i= 0; i < image.size(); i++)
-        tmp(i)= gamma(image(i), invg);
-    
+    Image tmp= image;
+    pow_image(tmp, 1 / g);
     return tmp;
 }
 
-Image inverse_gamma( const Image& image, const float g= float(2.2) )
+Image inverse_gamma( const Image& image, const float g )
 {
-    Image tmp(image.width(), image.height());
-    
-    for(unsigned i= 0; i < image.size(); i++)
-        tmp(i)= gamma(image(i), g);
-    
+    Image tmp= image;
+    pow_image(tmp, g);
     return tmp;
 }
 
-float range( const Image& image )
+void histograms( const Image& image, std::vector<Histogram>& histograms, const std::function<Color (const Color& pixel, const int k)>& transform )
 {
-    float gmin= FLT_MAX;
-    float gmax= 0;
-    for(unsigned i= 0; i < image.size(); i++)
+    const int m= int(histograms.size());
+    for(int k= 0; k < m; k++)
     {
-        Color color= image(i);
-        float g= color.r + color.g + color.b;
-        
-        if(g < gmin) gmin= g;
-        if(g > gmax) gmax= g;
+        Histogram& h= histograms[k];
+        for(int i= 0; i < 102; i++)
+            h.bins[i]= 0;
+        h.imin= FLT_MAX;
+        h.imax= 0;
     }
     
-    int bins[100] = {};
-    for(unsigned i= 0; i < image.size(); i++)
-   {
-        Color color= image(i);
-        float g= color.r + color.g + color.b;
+    const int n= int(image.size());
+    #pragma omp parallel
+    {
+        std::vector<Histogram> tmp(histograms);
+        
+        #pragma omp for schedule(static)
+        for(int i= 0; i < n; i++)
+        {
+            Color pixel= image(size_t(i));
+            for(int k= 0; k < m; k++)
+            {
+                Histogram& h= tmp[k];
+                Color color= transform ? transform(pixel, k) : pixel;
+                float g= color.r + color.g + color.b;
+                
+                if(g < h.imin) h.imin= g;
+                if(g > h.imax) h.imax= g;
+                
+                if(g < h.gmin)
+                    h.bins[0]++;
+                else if(g > h.gmax)
+                    h.bins[101]++;
+                else
+                {
+                    // intervalle reduit a une valeur, ou nan : premiere classe
+                    float x= (h.gmax > h.gmin) ? (g - h.gmin) * 100 / (h.gmax - h.gmin) : 0;
+                    int b= (x >= 99) ? 99 : (x > 0 ? int(x) : 0);
+                    h.bins[b + 1]++;
+                }
+            }
+        }
         
-        int b= (g - gmin) * 100 / (gmax - gmin);
-        if(b >= 99) b= 99;
-        if(b < 0) b= 0;
-        bins[b]++;
+        #pragma omp critical
+        for(int k= 0; k < m; k++)
+        {
+            Histogram& h= histograms[k];
+            for(int i= 0; i < 102; i++)
+                h.bins[i]+= tmp[k].bins[i];
+            if(tmp[k].imin < h.imin) h.imin= tmp[k].imin;
+            if(tmp[k].imax > h.imax) h.imax= tmp[k].imax;
+        }
+    }
+}
+
+bool Histogram::percentile( const size_t n, const float percentile, float& saturation ) const
+{
+    float qbins= 0;
+    for(int i= 0; i < 102; i++)
+    {
+        qbins= qbins + float(bins[i]) / float(n);
+        if(qbins > percentile)
+        {
+            if(i == 0 || i == 101)
+                return false;
+            
+            saturation= gmin + float(i) / 100 * (gmax - gmin);
+            return true;
+        }
     }
     
+    saturation= gmax;
+    return true;
+}
+
+float range( const Image& image, const float percentile )
+{
+    Exposure exposure;
+    return range(image, exposure, percentile);
+}
+
+float range( const Image& image, Exposure& exposure, const float percentile )
+{
+    if(image.size() == 0)
+        return 0;
+    
+    std::vector<Histogram> h;
     float saturation= 0;
-    float qbins= 0;
-    for(unsigned i= 0; i < 100; i++)
+    if(exposure.valid)
+    {
+        // 1 seul parcours : histogramme dans l'intervalle de l'image precedente
+        h.assign(1, Histogram(exposure.gmin, exposure.gmax));
+        histograms(image, h);
+        if(h[0].percentile(image.size(), percentile, saturation))
+        {
+            exposure.gmin= h[0].imin;
+            exposure.gmax= h[0].imax;
+            return saturation;
+        }
+        // le percentile est en dehors de l'intervalle precedent, recommence avec celui de l'image
+    }
+    else
     {
-        qbins= qbins + float(bins[i]) / float(image.size());
-        if(qbins > .75f)
-            return gmin + float(i+1) / 100 * (gmax - gmin);
+        // min / max de la luminance, tous les pixels sont en dehors de l'intervalle vide
+        h.assign(1, Histogram());
+        histograms(image, h);
     }
     
-    return gmax;
+    h.assign(1, Histogram(h[0].imin, h[0].imax));
+    histograms(image, h);
+    h[0].percentile(image.size(), percentile, saturation);
+    
+    exposure.gmin= h[0].gmin;
+    exposure.gmax= h[0].gmax;
+    exposure.valid= true;
+    return saturation;
 }
 
 
 Image tone( const Image& image, const float saturation, const float gamma )
 {
-    Image tmp(image.width(), image.height());
+    Image tmp= image;
     
     float invg= 1 / gamma;
     float k= 1 / std::pow(saturation, invg);
-    for(unsigned i= 0; i < image.size(); i++)
+    const int n= int(tmp.size());
+    #pragma omp parallel for schedule(static)
+    for(int i= 0; i < n; i+= PIXEL_BLOCK)
     {
-        Color color= image(i);
-        if(std::isnan(color.r) || std::isnan(color.g) || std::isnan(color.b))
-            // marque les pixels pourris avec une couleur improbable...            
-            color= Color(1, 0, 1);
-        else
-            // sinon transformation gamma rgb -> srgb
-            color= Color(k * std::pow(color.r, invg), k * std::pow(color.g, invg), k * std::pow(color.b, invg));
+        // transformation gamma rgb -> srgb
+        const int m= std::min(PIXEL_BLOCK, n - i);
+        pow_colors(&tmp(size_t(i)), m, invg, k);
         
-        tmp(i)= Color(color, 1);
+        for(int j= i; j < i + m; j++)
+        {
+            Color color= tmp(size_t(j));
+            if(std::isnan(color.r) || std::isnan(color.g) || std::isnan(color.b))
+                // marque les pixels pourris avec une couleur improbable...
+                color= Color(1, 0, 1);
+            
+            tmp(size_t(j))= Color(color, 1);
+        }
     }
     
     return tmp;
 }
 
 
-Image read_image( const char *filename, const bool flipY )
+// indice du pixel i dans une image chargee par stbi, ligne par ligne depuis le haut de l'image : les lignes sont retournees pendant la conversion,
+// sans utiliser stbi_set_flip_vertically_on_load(), qui modifie l'etat global de stbi, et n'est pas utilisable par plusieurs threads.
+static size_t source_pixel( const int i, const int width, const int height, const bool flipY )
+{
+    if(!flipY)
+        return size_t(i);
+    
+    int y= i / width;
+    int x= i % width;
+    return size_t(height -1 - y) * width + x;
+}
+
+// ecrit la couleur du pixel i, convertie dans le format de l'image : Image, ou ImageT<Pixel>, cf read_image_pixels()
+inline void set_pixel( Image& image, const size_t i, const Color& color ) { image(i)= color; }
+
+template < typename Pixel >
+inline void set_pixel( ImageT<Pixel>& image, const size_t i, const Color& color ) { image(i)= Pixel(color); }
+
+// conversion d'une image 8 bits rgba : alpha dans [0 .. 1], r, g, b dans [0 .. 1] puis transformation gamma inverse, cf read_image().
+// I est Image, ou une image compacte, ImageT<Pixel> : les formats 8 bits conservent les valeurs, avec g == 1.
+template < typename I >
+static I rgba8_pixels( const unsigned char *data, const int width, const int height, const float g, const bool flipY= false )
+{
+    float unorm[256];
+    float linear[256];
+    for(int i= 0; i < 256; i++)
+    {
+        unorm[i]= float(i) * (1 / float(255));
+        linear[i]= (g == 1) ? unorm[i] : std::pow(unorm[i], g);
+    }
+    
+    I image(width, height);
+    const int n= int(image.size());
+    #pragma omp parallel for schedule(static)
+    for(int i= 0; i < n; i++)
+    {
+        const unsigned char *p= data + 4*source_pixel(i, width, height, flipY);
+        set_pixel(image, size_t(i), Color(linear[p[0]], linear[p[1]], linear[p[2]], unorm[p[3]]));
+    }
+    
+    return image;
+}
+
+// charge une image .qoi, ou avec stbi, et la convertit dans le format de I : Image, ou une image compacte, ImageT<Pixel>, sans passer par une Image float.
+template < typename I >
+static I read_image_pixels( const char *filename, const bool flipY, const float g )
 {
-    stbi_set_flip_vertically_on_load(flipY);
+    int width, height, channels;
+    const char *ext= strrchr(filename, '.');
+    if(ext && strcmp(ext, ".qoi") == 0)
+    {
+        std::vector<unsigned char> data;
+        if(!read_qoi(filename, data, width, height, flipY))
+            return {};
+        
+        return rgba8_pixels<I>(data.data(), width, height, g);
+    }
     
     if(!stbi_is_hdr(filename))
     {
-        int width, height, channels;
         unsigned char *data= stbi_load(filename, &width, &height, &channels, 4);
         if(!data)
         {
@@ -112,27 +259,12 @@ Image read_image( const char *filename, const bool flipY )
             return {};
         }
         
-        Image image(width, height);
-        for(unsigned i= 0, offset= 0; i < image.size(); i++, offset+= 4)
-        {
-            Color pixel= Color( 
-                data[offset], 
-                data[offset + 1],
-                data[offset + 2],
-                data[offset + 3]) / 255;
-            image(i)= pixel;
-        }
-        
+        I image= rgba8_pixels<I>(data, width, height, g, flipY);
         stbi_image_free(data);
         return image;
-        
-        // \todo utiliser stbi_loadf() dans tous les cas, + parametres de conversion
-        //     stbi_ldr_to_hdr_scale(1.0f);
-        //     stbi_ldr_to_hdr_gamma(2.2f);
     }
     else
     {
-        int width, height, channels;
         float *data= stbi_loadf(filename, &width, &height, &channels, 4);
         if(!data)
         {
@@ -140,22 +272,97 @@ Image read_image( const char *filename, const bool flipY )
             return {};
         }
         
-        Image image(width, height);
-        for(unsigned i= 0, offset= 0; i < image.size(); i++, offset+= 4)
+        I image(width, height);
+        const int n= int(image.size());
+        #pragma omp parallel for schedule(static)
+        for(int i= 0; i < n; i++)
         {
-            Color pixel= Color( 
-                data[offset], 
-                data[offset + 1],
-                data[offset + 2],
-                data[offset + 3]);
-            image(i)= pixel;
+            const float *p= data + 4*source_pixel(i, width, height, flipY);
+            set_pixel(image, size_t(i), Color(p[0], p[1], p[2], p[3]));
         }
         
         stbi_image_free(data);
         return image;
     }
+}
+
+Image read_image( const char *filename, const bool flipY, const float g )
+{
+    return read_image_pixels<Image>(filename, flipY, g);
+}
+
+// retourne les lignes d'une image, sur place, en parallele.
+static void flip_rows( unsigned char *data, const size_t row_size, const int height )
+{
+    #pragma omp parallel for schedule(static)
+    for(int y= 0; y < height / 2; y++)
+        std::swap_ranges(data + row_size * y, data + row_size * (y +1), data + row_size * (height -1 - y));
+}
+
+// charge une image avec stbi, directement dans le format du pixel : l'image adopte les pixels decodes, sans copie, cf ImageT( w, h, data, owner ).
+// RGB8 et RGBA8 : 3 ou 4 composantes 8 bits, RGB32F : 3 composantes float, uniquement pour les images .hdr, les images 8 bits seraient converties par stbi_ldr_to_hdr_gamma(), etat global de stbi.
+template < typename Pixel >
+static ImageT<Pixel> stbi_pixels( const char *filename, const bool flipY )
+{
+    const bool hdr= std::is_same<Pixel, RGB32F>::value;
+    const int channels= hdr ? 3 : int(sizeof(Pixel));
+    
+    int width, height, n;
+    void *data= hdr ? (void *) stbi_loadf(filename, &width, &height, &n, channels) : (void *) stbi_load(filename, &width, &height, &n, channels);
+    if(!data)
+    {
+        printf("[error] loading '%s'...\n", filename);
+        return {};
+    }
+    
+    if(flipY)
+        flip_rows((unsigned char *) data, size_t(width) * sizeof(Pixel), height);
+    
+    std::shared_ptr<void> owner(data, stbi_image_free);
+    return ImageT<Pixel>(width, height, (Pixel *) data, owner);
+}
+
+ImageRGB8 read_image_rgb8( const char *filename, const bool flipY )
+{
+    const char *ext= strrchr(filename, '.');
+    if((ext && strcmp(ext, ".qoi") == 0) || stbi_is_hdr(filename))
+        return read_image_pixels<ImageRGB8>(filename, flipY, 1);
+    
+    return stbi_pixels<RGB8>(filename, flipY);
+}
+
+ImageRGBA8 read_image_rgba8( const char *filename, const bool flipY )
+{
+    const char *ext= strrchr(filename, '.');
+    if(ext && strcmp(ext, ".qoi") == 0)
+    {
+        // l'image adopte les pixels decodes
+        std::shared_ptr< std::vector<unsigned char> > data= std::make_shared< std::vector<unsigned char> >();
+        int width, height;
+        if(!read_qoi(filename, *data, width, height, flipY))
+            return {};
+        
+        return ImageRGBA8(width, height, (RGBA8 *) data->data(), data);
+    }
     
-    return {};
+    if(stbi_is_hdr(filename))
+        return read_image_pixels<ImageRGBA8>(filename, flipY, 1);
+    
+    return stbi_pixels<RGBA8>(filename, flipY);
+}
+
+ImageRGB16F read_image_rgb16f( const char *filename, const bool flipY, const float g )
+{
+    return read_image_pixels<ImageRGB16F>(filename, flipY, g);
+}
+
+ImageRGB32F read_image_rgb32f( const char *filename, const bool flipY, const float g )
+{
+    const char *ext= strrchr(filename, '.');
+    if((ext && strcmp(ext, ".qoi") == 0) || !stbi_is_hdr(filename))
+        return read_image_pixels<ImageRGB32F>(filename, flipY, g);
+    
+    return stbi_pixels<RGB32F>(filename, flipY);
 }
 
 inline float clamp( const float x, const float min, const float max )
@@ -166,11 +373,17 @@ inline float clamp( const float x, const float min, const float max )
 }
 
 
-bool write_image_png( const Image& image, const char *filename, const bool flipY )
+bool write_image_png( const unsigned char *pixels, const int width, const int height, const char *filename, const bool flipY, const PNGCompression compression )
 {
-    if(image.size() == 0)
+    if(width * height == 0)
         return false;
     
+    return write_png(pixels, width, height, filename, flipY, compression);
+}
+
+// conversion d'une image en 8 bits rgba
+static std::vector<unsigned char> rgba8( const Image& image )
+{
     std::vector<unsigned char> tmp(image.width()*image.height()*4);
     for(unsigned i= 0, offset= 0; i < image.size(); i++, offset+= 4)
     {
@@ -181,8 +394,43 @@ bool write_image_png( const Image& image, const char *filename, const bool flipY
         tmp[offset +3]= clamp(pixel.a, 0, 255);
     }
     
-    stbi_flip_vertically_on_write(flipY);
-    return stbi_write_png(filename, image.width(), image.height(), 4, tmp.data(), image.width() * 4) != 0;
+    return tmp;
+}
+
+bool write_image_png( const Image& image, const char *filename, const bool flipY, const PNGCompression compression )
+{
+    if(image.size() == 0)
+        return false;
+    
+    std::vector<unsigned char> tmp= rgba8(image);
+    return write_image_png(tmp.data(), image.width(), image.height(), filename, flipY, compression);
+}
+
+bool write_image_qoi( const unsigned char *pixels, const int width, const int height, const char *filename, const bool flipY )
+{
+    if(width * height == 0)
+        return false;
+    
+    return write_qoi(pixels, width, height, filename, flipY);
+}
+
+bool write_image_qoi( const Image& image, const char *filename, const bool flipY )
+{
+    if(image.size() == 0)
+        return false;
+    
+    std::vector<unsigned char> tmp= rgba8(image);
+    return write_image_qoi(tmp.data(), image.width(), image.height(), filename, flipY);
+}
+
+Image read_image_qoi( const char *filename, const bool flipY, const float g )
+{
+    std::vector<unsigned char> data;
+    int width, height;
+    if(!read_qoi(filename, data, width, height, flipY))
+        return {};
+    
+    return rgba8_pixels<Image>(data.data(), width, height, g);
 }
 
 bool write_image( const Image& image, const char *filename, const bool flipY )
@@ -195,17 +443,18 @@ bool write_image_bmp( const Image& image, const char *filename, const bool flipY
     if(image.size() == 0)
         return false;
     
+    // retourne les lignes pendant la conversion, sans stbi_flip_vertically_on_write(), cf source_pixel()
     std::vector<unsigned char> tmp(image.width()*image.height()*4);
-    for(unsigned i= 0, offset= 0; i < image.size(); i++, offset+= 4)
+    for(unsigned i= 0; i < image.size(); i++)
     {
-        Color pixel= image(i) * 255;
+        Color pixel= image(source_pixel(i, image.width(), image.height(), flipY)) * 255;
+        size_t offset= 4*size_t(i);
         tmp[offset   ]= pixel.r;
         tmp[offset +1]= pixel.g;
         tmp[offset +2]= pixel.b;
         tmp[offset +3]= pixel.a;
     }
     
-    stbi_flip_vertically_on_write(flipY);
     return stbi_write_bmp(filename, image.width(), image.height(), 4, tmp.data()) != 0;
 }
 
@@ -214,8 +463,23 @@ bool write_image_hdr( const Image& image, const char *filename, const bool flipY
     if(image.size() == 0)
         return false;
     
-    stbi_flip_vertically_on_write(flipY);
-    return stbi_write_hdr(filename, image.width(), image.height(), 4, image.data()) != 0;
+    if(!flipY)
+        return stbi_write_hdr(filename, image.width(), image.height(), 4, image.data()) != 0;
+    
+    // retourne les lignes, sans stbi_flip_vertically_on_write(), cf source_pixel()
+    std::vector<Color> tmp(image.size());
+    for(unsigned i= 0; i < image.size(); i++)
+        tmp[i]= image(source_pixel(i, image.width(), image.height(), flipY));
+    
+    return stbi_write_hdr(filename, image.width(), image.height(), 4, (const float *) tmp.data()) != 0;
+}
+
+bool write_image_exr( const Image& image, const char *filename, const bool flipY, const int tile, const EXRCompression compression )
+{
+    if(image.size() == 0)
+        return false;
+    
+    return write_exr(image.data(), image.width(), image.height(), filename, flipY, tile, compression);
 }
 
 bool write_image_preview( const Image& image, const char *filename, const bool flipY, const float g )
@@ -224,6 +488,6 @@ bool write_image_preview( const Image& image, const char *filename, const bool f
         return false;
     
     Image tmp= tone(image, range(image), g);
-    return write_image_png(tmp, filename, flipY);
+    return write_image_png(tmp, filename, flipY, PNG_FAST);
 }
 
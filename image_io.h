@@ -6,31 +6,109 @@
 ///@{
 
 
+#include <cfloat>
+#include <vector>
+#include <functional>
+
 #include "image.h"
+#include "image_formats.h"
+#include "png_writer.h"
+#include "exr_writer.h"
+
+/*! charge une image .bmp .tga .jpeg .png .qoi ou .hdr
+    les composantes r, g, b des images 8 bits sont transformees par c^g : 1, par defaut, les conserve, 2.2 les convertit de srgb vers rgb lineaire, cf inverse_gamma().
+    la conversion utilise une table de 256 valeurs, calculees avec std::pow(), sans erreur supplementaire. les images .hdr sont deja lineaires, g est ignore.
+    
+    les fonctions de lecture et d'ecriture n'utilisent pas d'etat global, flipY est traite pendant la conversion des pixels : plusieurs threads peuvent charger ou enregistrer des images en meme temps.
+*/
+Image read_image( const char *filename, const bool flipY= true, const float g= 1 );
+//! charge une image .qoi, cf read_qoi() et read_image().
+Image read_image_qoi( const char *filename, const bool flipY= true, const float g= 1 );
 
-//! charge une image .bmp .tga .jpeg .png ou .hdr
-Image read_image( const char *filename, const bool flipY= true );
+/*! charge une image 8 bits .bmp .tga .jpeg .png .qoi sans la convertir en float, 3 octets par pixel au lieu de 16, cf ImageT.
+    les valeurs sont conservees, une image srgb le reste : inverse_gamma() s'applique aux couleurs renvoyees par texture(). les images .hdr sont arrondies.
+    l'image adopte directement les pixels decodes, sans copie ni conversion : une seule copie de l'image en memoire pendant le chargement, cf ImageT::adopted().
+*/
+ImageRGB8 read_image_rgb8( const char *filename, const bool flipY= true );
+//! charge une image 8 bits, comme read_image_rgb8(), avec alpha, 4 octets par pixel, sans copie, y compris pour les images .qoi.
+ImageRGBA8 read_image_rgba8( const char *filename, const bool flipY= true );
+//! charge une image en half float, 6 octets par pixel, cf float_to_half(). les images 8 bits sont transformees par c^g, comme dans read_image().
+ImageRGB16F read_image_rgb16f( const char *filename, const bool flipY= true, const float g= 1 );
+//! charge une image en float, sans alpha, 12 octets par pixel, cf read_image(). les pixels des images .hdr ne sont pas copies, cf read_image_rgb8().
+ImageRGB32F read_image_rgb32f( const char *filename, const bool flipY= true, const float g= 1 );
 
 //! enregistre une image au format .png
 bool write_image( const Image& image, const char *filename, const bool flipY= true );
-//! enregistre une image au format .png
-bool write_image_png( const Image& image, const char *filename, const bool flipY= true );
+//! enregistre une image au format .png, cf write_png().
+bool write_image_png( const Image& image, const char *filename, const bool flipY= true, const PNGCompression compression= PNG_DEFAULT );
+//! enregistre une image 8 bits rgba, width x height pixels, au format .png, cf write_png().
+bool write_image_png( const unsigned char *pixels, const int width, const int height, const char *filename, const bool flipY= true, const PNGCompression compression= PNG_DEFAULT );
+//! enregistre une image au format .qoi, compression sans perte rapide, pour les images intermediaires, cf write_qoi().
+bool write_image_qoi( const Image& image, const char *filename, const bool flipY= true );
+//! enregistre une image 8 bits rgba, width x height pixels, au format .qoi, cf write_qoi().
+bool write_image_qoi( const unsigned char *pixels, const int width, const int height, const char *filename, const bool flipY= true );
 //! enregistre une image au format .bmp
 bool write_image_bmp( const Image& image, const char *filename, const bool flipY= true );
 //! enregistre une image au format .hdr
 bool write_image_hdr( const Image& image, const char *filename, const bool flipY= true );
+//! enregistre une image au format .exr, r, g, b en half float, en tuiles tile x tile, ou par lignes si tile == 0, compressees en parallele, cf write_exr().
+bool write_image_exr( const Image& image, const char *filename, const bool flipY= true, const int tile= 64, const EXRCompression compression= EXR_ZIP );
 
-//! raccourci pour write_image_png(tone(image, range(image)), "image.png")
+//! raccourci pour write_image_png(tone(image, range(image)), "image.png", flipY, PNG_FAST)
 bool write_image_preview( const Image& image, const char *filename, const bool flipY= true, const float gamma= float(2.2));
 
-//! transformation gamma : rgb lineaire vers srgb
+//! transformation gamma : rgb lineaire vers srgb, calculee par groupes de pixels, cf pow_colors() et l'erreur de vpow().
 Image gamma( const Image& image, const float g= float(2.2) );
-//! transformation gamma : srgb vers rgb lineaire
+//! transformation gamma : srgb vers rgb lineaire, calculee par groupes de pixels, cf pow_colors() et l'erreur de vpow().
 Image inverse_gamma( const Image& image, const float g= float(2.2) );
 
-//! evalue l'exposition d'une image.
-float range( const Image& image );
-//! correction de l'exposition d'une image + transformation gamma.
+//! intervalle de luminance de l'image precedente d'une sequence, cf range( image, exposure, percentile ).
+struct Exposure
+{
+    float gmin, gmax;
+    bool valid;
+    
+    Exposure( ) : gmin(0), gmax(0), valid(false) {}
+};
+
+//! histogramme de la luminance (r+g+b) des pixels d'une image, 100 classes dans [gmin .. gmax], cf histograms() et range().
+struct Histogram
+{
+    int bins[102];      //!< bins[1 .. 100] : classes de [gmin .. gmax], bins[0] et bins[101] : pixels en dehors de l'intervalle.
+    float gmin, gmax;   //!< intervalle de l'histogramme.
+    float imin, imax;   //!< luminance min / max des pixels.
+    
+    //! histogramme vide, dans l'intervalle [gmin .. gmax]. l'intervalle par defaut est vide : seules imin et imax sont calculees.
+    Histogram( const float _gmin= FLT_MAX, const float _gmax= FLT_MAX ) : bins(), gmin(_gmin), gmax(_gmax), imin(FLT_MAX), imax(0) {}
+    
+    //! luminance du percentile des n pixels, renvoie faux si elle est en dehors de [gmin .. gmax].
+    bool percentile( const size_t n, const float percentile, float& saturation ) const;
+};
+
+/*! construit les histogrammes de plusieurs versions d'une image, en un seul parcours, en parallele. 
+    transform( pixel, k ) renvoie la version k du pixel, pour histograms[k], ou le pixel lui meme, si transform n'est pas defini.
+    chaque thread construit ses histogrammes, ils sont additionnes a la fin.
+*/
+void histograms( const Image& image, std::vector<Histogram>& histograms, const std::function<Color (const Color& pixel, const int k)>& transform= nullptr );
+
+/*! evalue l'exposition d'une image : luminance (r+g+b) du percentile de ses pixels, 75% par defaut.
+    histogramme de 100 classes entre la luminance min et max, l'image est parcourue 2 fois, en parallele.
+*/
+float range( const Image& image, const float percentile= 0.75f );
+
+/*! evalue l'exposition d'une image d'une sequence, comme range( image, percentile ), mais l'histogramme utilise l'intervalle de luminance de l'image precedente, exposure.
+    l'image n'est parcourue qu'une fois, sauf si le percentile est en dehors de cet intervalle ou pour la premiere image. exposure est mis a jour pour l'image suivante.
+    \code
+    Exposure exposure;
+    for(int frame= 0; ; frame++)
+    {
+        Image image= ... ;
+        Image tmp= tone(image, range(image, exposure));
+    }
+    \endcode
+*/
+float range( const Image& image, Exposure& exposure, const float percentile= 0.75f );
+//! correction de l'exposition d'une image + transformation gamma, cf pow_colors() et l'erreur de vpow().
 Image tone( const Image& image, const float saturation, const float gamma= float(2.2) );
 
 ///@}
@@ -0,0 +1,111 @@
+
+#include <cstdio>
+
+#ifdef _WIN32
+    #include <windows.h>
+#else
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+#include "mapped_file.h"
+
+
+bool MappedFile::open( const char *filename )
+{
+    close();
+
+#ifdef _WIN32
+    HANDLE file= CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if(file == INVALID_HANDLE_VALUE)
+    {
+        printf("[error] mapping '%s'...\n", filename);
+        return false;
+    }
+
+    LARGE_INTEGER size;
+    if(!GetFileSizeEx(file, &size) || size.QuadPart == 0)
+    {
+        printf("[error] mapping '%s'...\n", filename);
+        CloseHandle(file);
+        return false;
+    }
+
+    HANDLE mapping= CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    CloseHandle(file);     // la projection garde le fichier ouvert
+    if(mapping == nullptr)
+    {
+        printf("[error] mapping '%s'...\n", filename);
+        return false;
+    }
+
+    void *data= MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if(data == nullptr)
+    {
+        printf("[error] mapping '%s'...\n", filename);
+        CloseHandle(mapping);
+        return false;
+    }
+
+    m_data= (const char *) data;
+    m_size= size_t(size.QuadPart);
+    m_handle= mapping;
+
+#else
+    int fd= ::open(filename, O_RDONLY);
+    if(fd < 0)
+    {
+        printf("[error] mapping '%s'...\n", filename);
+        return false;
+    }
+
+    struct stat info;
+    if(fstat(fd, &info) < 0 || info.st_size == 0)
+    {
+        printf("[error] mapping '%s'...\n", filename);
+        ::close(fd);
+        return false;
+    }
+
+    void *data= mmap(nullptr, size_t(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);   // la projection reste valide
+    if(data == MAP_FAILED)
+    {
+        printf("[error] mapping '%s'...\n", filename);
+        return false;
+    }
+
+    m_data= (const char *) data;
+    m_size= size_t(info.st_size);
+#endif
+
+    return true;
+}
+
+void MappedFile::close( )
+{
+    if(m_data == nullptr)
+        return;
+
+#ifdef _WIN32
+    UnmapViewOfFile(m_data);
+    CloseHandle((HANDLE) m_handle);
+#else
+    munmap((void *) m_data, m_size);
+#endif
+
+    m_data= nullptr;
+    m_size= 0;
+    m_handle= nullptr;
+}
+
+
+std::shared_ptr<MappedFile> map_file( const char *filename )
+{
+    std::shared_ptr<MappedFile> file= std::make_shared<MappedFile>();
+    if(!file->open(filename))
+        return nullptr;
+    return file;
+}
@@ -0,0 +1,54 @@
+
+#ifndef _MAPPED_FILE_H
+#define _MAPPED_FILE_H
+
+#include <cstddef>
+#include <memory>
+
+
+//! \file
+//! fichier projete en memoire, en lecture seule.
+
+/*! fichier projete en memoire, en lecture seule : le contenu du fichier est accessible directement, sans le lire ni le copier.
+    le systeme charge les pages du fichier a la demande, lors du premier acces.
+
+    exemple :
+    \code
+    MappedFile file;
+    if(!file.open("scene.bin"))
+        return "erreur";
+
+    const char *data= file.data();
+    size_t size= file.size();
+    ...
+    \endcode
+*/
+class MappedFile
+{
+public:
+    MappedFile( ) : m_data(nullptr), m_size(0), m_handle(nullptr) {}
+    ~MappedFile( ) { close(); }
+
+    //! projette le fichier en memoire. renvoie faux en cas d'erreur, ou si le fichier est vide.
+    bool open( const char *filename );
+    //! libere la projection.
+    void close( );
+
+    //! renvoie le contenu du fichier.
+    const char *data( ) const { return m_data; }
+    //! renvoie la taille du fichier, en octets.
+    size_t size( ) const { return m_size; }
+
+    MappedFile( const MappedFile& ) = delete;
+    MappedFile& operator= ( const MappedFile& ) = delete;
+
+protected:
+    const char *m_data;
+    size_t m_size;
+    void *m_handle;     // windows : objet de la projection
+};
+
+//! projette un fichier en memoire, renvoie nullptr en cas d'erreur. la projection est liberee avec le dernier shared_ptr, cf Buffer.
+std::shared_ptr<MappedFile> map_file( const char *filename );
+
+#endif
@@ -4,6 +4,7 @@
 
 #include <string>
 #include <vector>
+#include <unordered_map>
 #include <cassert>
 
 #include "color.h"
@@ -41,6 +42,9 @@ struct Material
     filename( material.diffuse_texture ) renvoie le nom de l'image a charger qui correspond a la texture diffuse de la matiere.
     
     pourquoi cette indexation supplementaire ? pour eviter de charger plusieurs fois une image / creer plusieurs fois une texture. 
+    
+    find() et find_texture() utilisent une table de hachage, completee a la demande : les noms ajoutes directement a names ou a texture_filenames sont aussi indexes.
+    par contre, modifier un nom deja indexe n'est pas detecte, utiliser clear().
 */
 struct Materials
 {
@@ -49,7 +53,7 @@ struct Materials
     std::vector<std::string> texture_filenames; //!< noms des textures a charger.
     int default_material_id;    //!< indice de la matiere par defaut dans materials.
     
-    Materials( ) : names(), materials(), texture_filenames(), default_material_id(-1) {}
+    Materials( ) : names(), materials(), texture_filenames(), default_material_id(-1), name_index(), texture_index(), indexed_names(0), indexed_textures(0) {}
     
     void clear( ) 
     {
@@ -57,6 +61,11 @@ struct Materials
         materials.clear();
         texture_filenames.clear();
         default_material_id= -1;
+        
+        name_index.clear();
+        texture_index.clear();
+        indexed_names= 0;
+        indexed_textures= 0;
     }
     
     //! ajoute une matiere.
@@ -91,12 +100,7 @@ struct Materials
         if(name == nullptr || name[0] == 0)
             return -1;
         
-        for(int i= 0; i < int(names.size()); i++)
-        {
-            if(names[i] == name)
-                return i;
-        }
-        return -1;
+        return find(name_index, indexed_names, names, name);
     }
     
     //! nombre de matieres.
@@ -155,12 +159,33 @@ struct Materials
         if(filename == nullptr || filename[0] == 0)
             return -1;
         
-        for(int i= 0; i < int(texture_filenames.size()); i++)
+        return find(texture_index, indexed_textures, texture_filenames, filename);
+    }
+    
+protected:
+    std::unordered_map<std::string, int> name_index;    // indice de chaque nom de matiere
+    std::unordered_map<std::string, int> texture_index; // indice de chaque nom de texture
+    int indexed_names;          // nombre de noms deja indexes, names[0 .. indexed_names[
+    int indexed_textures;       // nombre de noms deja indexes, texture_filenames[0 .. indexed_textures[
+    
+    // indexe les noms ajoutes depuis la derniere recherche, puis recherche name.
+    // si un nom apparait plusieurs fois, la table garde le premier indice, comme une recherche lineaire.
+    static int find( std::unordered_map<std::string, int>& index, int& indexed, const std::vector<std::string>& strings, const char *name )
+    {
+        if(indexed > int(strings.size()))
         {
-            if(texture_filenames[i] == filename)
-                return i;
+            // le tableau a ete raccourci, reconstruit l'index
+            index.clear();
+            indexed= 0;
         }
-        return -1;
+        
+        for(; indexed < int(strings.size()); indexed++)
+            index.emplace(strings[indexed], indexed);
+        
+        auto found= index.find(name);
+        if(found == index.end())
+            return -1;
+        return found->second;
     }
 };
 
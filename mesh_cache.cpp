@@ -0,0 +1,251 @@
+
+#include <cstdio>
+#include <cstring>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <type_traits>
+
+#include "mesh_cache.h"
+#include "mapped_file.h"
+#include "files.h"
+
+
+namespace {
+
+const char mesh_magic[8]= { 'M', 'E', 'S', 'H', 'B', 'I', 'N', 0 };
+const uint32_t mesh_version= 2;
+
+// alignement des tableaux dans le fichier
+const uint64_t mesh_alignment= 64;
+
+// les tableaux sont ecrits et relus tels quels
+static_assert(std::is_trivially_copyable<Point>::value && std::is_trivially_copyable<Vector>::value && std::is_trivially_copyable<Material>::value, "mesh cache");
+
+// entete du fichier binaire : les tableaux sont reperes par leur position dans le fichier, en octets
+struct MeshHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t point_size, vector_size, material_size;   // verifie que le fichier est compatible
+
+    uint64_t position_count, texcoord_count, normal_count;
+    uint64_t index_count, material_index_count;
+    uint64_t material_count, texture_count, source_count;
+    int64_t default_material;
+
+    uint64_t positions, texcoords, normals;
+    uint64_t indices, material_indices;
+    uint64_t materials;
+    uint64_t strings;       // StringRecord : noms des matieres, puis noms des textures, puis noms des sources
+    uint64_t sources;       // SourceRecord : date de modification et taille des sources
+    uint64_t chars;         // contenu des chaines de caracteres
+    uint64_t chars_size;
+};
+
+struct StringRecord
+{
+    uint64_t offset;
+    uint64_t length;
+};
+
+// version d'un fichier source : la date de modification est a la seconde pres, la taille detecte aussi les modifications faites dans la meme seconde
+struct SourceRecord
+{
+    uint64_t timestamp;
+    uint64_t size;
+};
+
+// reserve la place d'un tableau de n elements, aligne, et renvoie sa position dans le fichier
+uint64_t allocate( uint64_t& offset, const uint64_t n, const uint64_t size )
+{
+    uint64_t begin= (offset + mesh_alignment -1) / mesh_alignment * mesh_alignment;
+    offset= begin + n * size;
+    return begin;
+}
+
+// ecriture sequentielle des tableaux, dans l'ordre de allocate(), cf SceneWriter
+struct MeshWriter
+{
+    FILE *out;
+    uint64_t position;
+
+    // ecrit n elements a la position offset du fichier, complete avec des 0 depuis la fin du tableau precedent
+    bool write( const uint64_t offset, const void *data, const uint64_t n, const uint64_t size )
+    {
+        for(; position < offset; position++)
+            if(fputc(0, out) == EOF)
+                return false;
+
+        position+= n * size;
+        return n == 0 || fwrite(data, size, n, out) == n;
+    }
+};
+
+// verifie que le tableau [offset .. offset + n*size[ est dans le fichier
+bool inside( const MappedFile& file, const uint64_t offset, const uint64_t n, const uint64_t size )
+{
+    return offset <= file.size() && n <= (file.size() - offset) / size;
+}
+
+template < typename T >
+void copy( const MappedFile& file, const uint64_t offset, const uint64_t n, std::vector<T>& v )
+{
+    const T *data= (const T *) (file.data() + offset);
+    v.assign(data, data + n);
+}
+
+}
+
+
+std::string mesh_cache_filename( const char *filename, const char *directory )
+{
+    return cache_filename(filename, directory ? directory : "", ".cache");
+}
+
+
+bool write_mesh_cache( const char *filename, const MeshIOData& data, const std::vector<std::string>& sources )
+{
+    const Materials& materials= data.materials;
+
+    // noms des matieres, des textures et des sources, et date de modification des sources
+    std::string chars;
+    std::vector<StringRecord> strings;
+    std::vector<SourceRecord> versions;
+    auto insert= [&]( const std::string& s ) { strings.push_back( { chars.size(), s.size() } ); chars+= s; };
+    for(const std::string& name : materials.names)
+        insert(name);
+    for(const std::string& name : materials.texture_filenames)
+        insert(name);
+    for(const std::string& source : sources)
+    {
+        insert(normalize_filename(source));
+        versions.push_back( { timestamp(source), file_size(source) } );
+    }
+
+    MeshHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, mesh_magic, sizeof(mesh_magic));
+    header.version= mesh_version;
+    header.point_size= sizeof(Point);
+    header.vector_size= sizeof(Vector);
+    header.material_size= sizeof(Material);
+
+    header.position_count= data.positions.size();
+    header.texcoord_count= data.texcoords.size();
+    header.normal_count= data.normals.size();
+    header.index_count= data.indices.size();
+    header.material_index_count= data.material_indices.size();
+    header.material_count= materials.materials.size();
+    header.texture_count= materials.texture_filenames.size();
+    header.source_count= sources.size();
+    header.default_material= materials.default_material_id;
+
+    uint64_t offset= sizeof(MeshHeader);
+    header.positions= allocate(offset, header.position_count, sizeof(Point));
+    header.texcoords= allocate(offset, header.texcoord_count, sizeof(Point));
+    header.normals= allocate(offset, header.normal_count, sizeof(Vector));
+    header.indices= allocate(offset, header.index_count, sizeof(int));
+    header.material_indices= allocate(offset, header.material_index_count, sizeof(int));
+    header.materials= allocate(offset, header.material_count, sizeof(Material));
+    header.strings= allocate(offset, strings.size(), sizeof(StringRecord));
+    header.sources= allocate(offset, versions.size(), sizeof(SourceRecord));
+    header.chars= allocate(offset, chars.size(), 1);
+    header.chars_size= chars.size();
+
+    // fichier temporaire, renomme a la fin
+    std::string tmp= std::string(filename) + ".tmp";
+    FILE *out= fopen(tmp.c_str(), "wb");
+    if(!out)
+    {
+        printf("[error] writing mesh cache '%s'...\n", filename);
+        return false;
+    }
+
+    MeshWriter writer= { out, 0 };
+    bool error= !writer.write(0, &header, 1, sizeof(header))
+        || !writer.write(header.positions, data.positions.data(), header.position_count, sizeof(Point))
+        || !writer.write(header.texcoords, data.texcoords.data(), header.texcoord_count, sizeof(Point))
+        || !writer.write(header.normals, data.normals.data(), header.normal_count, sizeof(Vector))
+        || !writer.write(header.indices, data.indices.data(), header.index_count, sizeof(int))
+        || !writer.write(header.material_indices, data.material_indices.data(), header.material_index_count, sizeof(int))
+        || !writer.write(header.materials, materials.materials.data(), header.material_count, sizeof(Material))
+        || !writer.write(header.strings, strings.data(), strings.size(), sizeof(StringRecord))
+        || !writer.write(header.sources, versions.data(), versions.size(), sizeof(SourceRecord))
+        || !writer.write(header.chars, chars.data(), chars.size(), 1);
+
+    if(fclose(out) != 0 || error || std::rename(tmp.c_str(), filename) != 0)
+    {
+        printf("[error] writing mesh cache '%s'...\n", filename);
+        std::remove(tmp.c_str());
+        return false;
+    }
+
+    return true;
+}
+
+
+bool read_mesh_cache( const char *filename, const char *source, MeshIOData& data )
+{
+    if(!exists(filename))
+        return false;
+
+    std::shared_ptr<MappedFile> file= map_file(filename);
+    if(file == nullptr || file->size() < sizeof(MeshHeader) || memcmp(file->data(), mesh_magic, sizeof(mesh_magic)) != 0)
+        return false;
+
+    MeshHeader header;
+    memcpy(&header, file->data(), sizeof(header));
+
+    uint64_t string_count= header.material_count + header.texture_count + header.source_count;
+    if(header.version != mesh_version
+    || header.point_size != sizeof(Point) || header.vector_size != sizeof(Vector) || header.material_size != sizeof(Material)
+    || !inside(*file, header.positions, header.position_count, sizeof(Point))
+    || !inside(*file, header.texcoords, header.texcoord_count, sizeof(Point))
+    || !inside(*file, header.normals, header.normal_count, sizeof(Vector))
+    || !inside(*file, header.indices, header.index_count, sizeof(int))
+    || !inside(*file, header.material_indices, header.material_index_count, sizeof(int))
+    || !inside(*file, header.materials, header.material_count, sizeof(Material))
+    || !inside(*file, header.strings, string_count, sizeof(StringRecord))
+    || header.source_count == 0
+    || !inside(*file, header.sources, header.source_count, sizeof(SourceRecord))
+    || !inside(*file, header.chars, header.chars_size, 1))
+        return false;
+
+    const StringRecord *records= (const StringRecord *) (file->data() + header.strings);
+    std::vector<std::string> strings;
+    for(uint64_t i= 0; i < string_count; i++)
+    {
+        if(records[i].offset > header.chars_size || records[i].length > header.chars_size - records[i].offset)
+            return false;
+        strings.push_back( std::string(file->data() + header.chars + records[i].offset, records[i].length) );
+    }
+
+    // verifie que le cache est celui de l'objet, et que les sources n'ont pas ete modifiees
+    const std::string *sources= strings.data() + header.material_count + header.texture_count;
+    if(sources[0] != normalize_filename(source))
+        return false;
+
+    const SourceRecord *versions= (const SourceRecord *) (file->data() + header.sources);
+    for(uint64_t i= 0; i < header.source_count; i++)
+    {
+        if(timestamp(sources[i]) != versions[i].timestamp || file_size(sources[i]) != versions[i].size)
+            return false;
+    }
+
+    MeshIOData tmp;
+    copy(*file, header.positions, header.position_count, tmp.positions);
+    copy(*file, header.texcoords, header.texcoord_count, tmp.texcoords);
+    copy(*file, header.normals, header.normal_count, tmp.normals);
+    copy(*file, header.indices, header.index_count, tmp.indices);
+    copy(*file, header.material_indices, header.material_index_count, tmp.material_indices);
+
+    Materials& materials= tmp.materials;
+    copy(*file, header.materials, header.material_count, materials.materials);
+    materials.names.assign(strings.begin(), strings.begin() + header.material_count);
+    materials.texture_filenames.assign(strings.begin() + header.material_count, strings.begin() + header.material_count + header.texture_count);
+    materials.default_material_id= int(header.default_material);
+
+    data= std::move(tmp);
+    return true;
+}
@@ -0,0 +1,33 @@
+
+#ifndef _MESH_CACHE_H
+#define _MESH_CACHE_H
+
+#include <string>
+#include <vector>
+
+#include "mesh_io.h"
+
+
+//! \file
+//! cache binaire des objets charges par read_meshio_data() : attributs, indices et matieres, sans analyser a nouveau les fichiers .obj et .mtl.
+
+/*! enregistre les attributs, les indices et les matieres d'un objet au format binaire, cf read_mesh_cache().
+    sources : fichier .obj de l'objet, puis ses fichiers .mtl. leurs noms, leur date de modification et leur taille sont conserves pour verifier que le cache est a jour.
+    le cache est ecrit dans un fichier temporaire, puis renomme : un autre processus ne peut pas lire un cache incomplet.
+    le fichier est lu par read_mesh_cache() sur une machine de meme architecture (taille des types et ordre des octets), la version et les tailles sont verifiees au chargement.
+*/
+bool write_mesh_cache( const char *filename, const MeshIOData& data, const std::vector<std::string>& sources );
+
+/*! charge l'objet source, enregistre par write_mesh_cache() dans le cache filename. le fichier est projete en memoire, cf MappedFile, et les tableaux sont copies directement.
+    renvoie faux, sans message, si le cache n'existe pas, s'il est incompatible, s'il a ete construit pour un autre fichier que source,
+    ou si l'un des fichiers sources a ete modifie depuis son ecriture : date de modification, cf timestamp(), ou taille differente.
+    les images des matieres ne sont pas chargees, cf read_images().
+*/
+bool read_mesh_cache( const char *filename, const char *source, MeshIOData& data );
+
+/*! renvoie le nom du cache d'un fichier .obj : "objet.obj.cache", a cote du fichier, 
+    ou "objet-<hash>.obj.cache" dans le repertoire directory, s'il est defini. le hash du chemin complet distingue les objets de meme nom.
+*/
+std::string mesh_cache_filename( const char *filename, const char *directory= nullptr );
+
+#endif
@@ -1,9 +1,13 @@
 
 #include <cstdlib>
 #include <cassert>
-#include <map>
+#include <cstdint>
+#include <utility>
+#include <algorithm>
 
 #include "mesh_io.h"
+#include "obj_parser.h"
+#include "mesh_cache.h"
 
 #include "image.h"
 #include "image_io.h"
@@ -13,99 +17,24 @@ bool read_positions( const char *filename, std::vector<Point>& positions )
 {
     positions.clear();
     
-    FILE *in= fopen(filename, "rt");
-    if(!in)
-    {
-        printf("[error] loading mesh '%s'...\n", filename);
-        return false;
-    }
-    
     printf("loading mesh '%s'...\n", filename);
     
-    std::vector<Point> wpositions;
-    std::vector<int> wp;
-    
-    char line_buffer[1024];
-    bool error= true;
-    for(;;)
+    ObjData obj;
+    if(!read_obj(filename, obj))
     {
-        // charge une ligne du fichier
-        if(!fgets(line_buffer, sizeof(line_buffer), in))
-        {
-            error= false;       // fin du fichier, pas d'erreur detectee
-            break;
-        }
-        
-        // force la fin de la ligne, au cas ou
-        line_buffer[sizeof(line_buffer) -1]= 0;
-        
-        // saute les espaces en debut de ligne
-        char *line= line_buffer;
-        while(*line && isspace(*line))
-            line++;
-        
-        if(line[0] == 'v')
-        {
-            float x, y, z;
-            if(line[1] == ' ')          // position x y z
-            {
-                if(sscanf(line, "v %f %f %f", &x, &y, &z) != 3)
-                    break;
-                wpositions.push_back( Point(x, y, z) );
-            }
-        }
-        
-        else if(line[0] == 'f')         // triangle a b c, les sommets sont numerotes a partir de 1 ou de la fin du tableau (< 0)
-        {
-            wp.clear();
-            
-            int next= 0;
-            for(line= line +1; ; line= line + next)
-            {
-                wp.push_back(0); 
-                
-                // analyse les attributs du sommet : p/t/n ou p//n ou p/t ou p...
-                next= 0;
-                int wt= 0;
-                int wn= 0;
-                if(sscanf(line, " %d/%d/%d %n", &wp.back(), &wt, &wn, &next) == 3) 
-                    continue;
-                else if(sscanf(line, " %d/%d %n", &wp.back(), &wt, &next) == 2)
-                    continue;
-                else if(sscanf(line, " %d//%d %n", &wp.back(), &wn, &next) == 2)
-                    continue;
-                else if(sscanf(line, " %d %n", &wp.back(), &next) == 1)
-                    continue;
-                else if(next == 0)      // fin de ligne
-                    break;
-            }
-            
-            // triangule la face
-            for(unsigned v= 2; v +1 < wp.size(); v++)
-            {
-                unsigned idv[3]= { 0, v -1, v };
-                for(unsigned i= 0; i < 3; i++)
-                {
-                    unsigned k= idv[i];
-                    int p= (wp[k] < 0) ? int(wpositions.size()) + wp[k] : wp[k] -1;
-                    if(p < 0) break; // error
-                    
-                    // et duplique les positions...
-                    assert(p < int(wpositions.size()));
-                    positions.push_back(wpositions[p]);
-                }
-            }
-        }
+        printf("[error] loading mesh '%s'...\n", filename);
+        return false;
     }
     
-    fclose(in);
+    // duplique les positions des sommets des triangles
+    const int n= obj.triangle_count() * 3;
+    positions.resize(n);
+    #pragma omp parallel for schedule(static)
+    for(int i= 0; i < n; i++)
+        positions[i]= obj.positions[obj.vertices[3*i]];
     
-    if(error)
-        printf("[error] loading mesh '%s'...\n%s\n\n", filename, line_buffer);
-    else
-        printf("mesh '%s': %d positions\n", filename, int(positions.size()));
-
-    return !error;
+    printf("mesh '%s': %d positions\n", filename, int(positions.size()));
+    return true;
 }
 
 
@@ -114,97 +43,25 @@ bool read_indexed_positions( const char *filename, std::vector<Point>& positions
     positions.clear();
     indices.clear();
     
-    FILE *in= fopen(filename, "rt");
-    if(!in)
+    printf("loading indexed mesh '%s'...\n", filename);
+    
+    ObjData obj;
+    if(!read_obj(filename, obj))
     {
         printf("[error] loading indexed mesh '%s'...\n", filename);
         return false;
     }
     
-    printf("loading indexed mesh '%s'...\n", filename);
-    
-    std::vector<int> wp;
+    positions= std::move(obj.positions);
     
-    char line_buffer[1024];
-    bool error= true;
-    for(;;)
-    {
-        // charge une ligne du fichier
-        if(!fgets(line_buffer, sizeof(line_buffer), in))
-        {
-            error= false;       // fin du fichier, pas d'erreur detectee
-            break;
-        }
-        
-        // force la fin de la ligne, au cas ou
-        line_buffer[sizeof(line_buffer) -1]= 0;
-        
-        // saute les espaces en debut de ligne
-        char *line= line_buffer;
-        while(*line && isspace(*line))
-            line++;
-        
-        if(line[0] == 'v')
-        {
-            float x, y, z;
-            if(line[1] == ' ')          // position x y z
-            {
-                if(sscanf(line, "v %f %f %f", &x, &y, &z) != 3)
-                    break;
-                positions.push_back( Point(x, y, z) );
-            }
-        }
-        
-        else if(line[0] == 'f')         // triangle a b c, les sommets sont numerotes a partir de 1 ou de la fin du tableau (< 0)
-        {
-            wp.clear();
-            
-            int next= 0;
-            for(line= line +1; ; line= line + next)
-            {
-                wp.push_back(0); 
-                
-                // analyse les attributs du sommet : p/t/n ou p//n ou p/t ou p...
-                next= 0;
-                int wt= 0;
-                int wn= 0;
-                if(sscanf(line, " %d/%d/%d %n", &wp.back(), &wt, &wn, &next) == 3) 
-                    continue;
-                else if(sscanf(line, " %d/%d %n", &wp.back(), &wt, &next) == 2)
-                    continue;
-                else if(sscanf(line, " %d//%d %n", &wp.back(), &wn, &next) == 2)
-                    continue;
-                else if(sscanf(line, " %d %n", &wp.back(), &next) == 1)
-                    continue;
-                else if(next == 0)      // fin de ligne
-                    break;
-            }
-            
-            // triangule la face
-            for(unsigned v= 2; v +1 < wp.size(); v++)
-            {
-                unsigned idv[3]= { 0, v -1, v };
-                for(unsigned i= 0; i < 3; i++)
-                {
-                    unsigned k= idv[i];
-                    int p= (wp[k] < 0) ? int(positions.size()) + wp[k] : wp[k] -1;
-                    if(p < 0) break; // error
-                    
-                    assert(p < int(positions.size()));
-                    indices.push_back(p);
-                }
-            }
-        }
-    }
-    
-    fclose(in);
+    const int n= obj.triangle_count() * 3;
+    indices.resize(n);
+    #pragma omp parallel for schedule(static)
+    for(int i= 0; i < n; i++)
+        indices[i]= obj.vertices[3*i];
     
-    if(error)
-        printf("[error] loading indexed mesh '%s'...\n%s\n\n", filename, line_buffer);
-    else
-        printf("indexed mesh '%s': %d positions, %d indices\n", filename, int(positions.size()), int(indices.size()));
-
-    return !error;
+    printf("indexed mesh '%s': %d positions, %d indices\n", filename, int(positions.size()), int(indices.size()));
+    return true;
 }
 
 
@@ -299,105 +156,66 @@ bool read_materials_mtl( const char *filename, Materials& materials  )
     return !error;
 }
 
-bool read_materials( const char *filename, Materials& materials, std::vector<int>& indices )
+// charge les fichiers de matieres et associe une matiere a chaque triangle, en suivant les commandes mtllib et usemtl, dans l'ordre du fichier .obj.
+// les triangles sans matiere utilisent la matiere par defaut. sources, si defini, recoit le nom des fichiers de matieres charges.
+static bool obj_materials( const char *filename, const ObjData& obj, Materials& materials, std::vector<int>& indices, std::vector<std::string> *sources= nullptr )
 {
-    indices.clear();
-    
-    FILE *in= fopen(filename, "rt");
-    if(!in)
-    {
-        printf("[error] loading materials '%s'...\n", filename);
-        return false;
-    }
-    
-    printf("loading materials '%s'...\n", filename);
+    const int n= obj.triangle_count();
+    const std::vector<ObjCommand>& commands= obj.commands;
     
-    std::vector<int> wp;
     int material_id= -1;
-    
-    char tmp[1024];
-    char line_buffer[1024];
-    bool error= true;
-    for(;;)
+    size_t next= 0;
+    for(int i= 0; i <= n; i++)
     {
-        // charge une ligne du fichier
-        if(!fgets(line_buffer, sizeof(line_buffer), in))
+        for(; next < commands.size() && commands[next].triangle <= i; next++)
         {
-            error= false;       // fin du fichier, pas d'erreur detectee
-            break;
-        }
-        
-        // force la fin de la ligne, au cas ou
-        line_buffer[sizeof(line_buffer) -1]= 0;
-        
-        // saute les espaces en debut de ligne
-        char *line= line_buffer;
-        while(*line && isspace(*line))
-            line++;
-        
-        if(line[0] == 'f')         // triangle a b c
-        {
-            wp.clear();
-            
-            int next= 0;
-            for(line= line +1; ; line= line + next)
-            {
-                wp.push_back(0); 
-                
-                // analyse les attributs du sommet : p/t/n ou p//n ou p/t ou p...
-                next= 0;
-                int wt= 0;
-                int wn= 0;
-                if(sscanf(line, " %d/%d/%d %n", &wp.back(), &wt, &wn, &next) == 3) 
-                    continue;
-                else if(sscanf(line, " %d/%d %n", &wp.back(), &wt, &next) == 2)
-                    continue;
-                else if(sscanf(line, " %d//%d %n", &wp.back(), &wn, &next) == 2)
-                    continue;
-                else if(sscanf(line, " %d %n", &wp.back(), &next) == 1)
-                    continue;
-                else if(next == 0)      // fin de ligne
-                    break;
-            }
-            
-            // force une matiere par defaut, si necessaire
-            if(material_id == -1)
-                material_id= materials.default_material_index();
-            
-            // triangule la face
-            for(unsigned v= 2; v +1 < wp.size(); v++)
-                // indice de la matiere de chaque triangle
-                indices.push_back(material_id);
-        }
-        else if(line[0] == 'm')
-        {
-            if(sscanf(line, "mtllib %[^\r\n]", tmp) == 1)
+            const ObjCommand& command= commands[next];
+            if(command.mtllib)
             {
                 std::string materials_filename;
-                if(tmp[0] != '/' && tmp[1] != ':')   // windows c:\ pour les chemins complets...
-                    materials_filename= normalize_filename(pathname(filename) + tmp);
+                if(command.name[0] != '/' && command.name[1] != ':')   // windows c:\ pour les chemins complets...
+                    materials_filename= normalize_filename(pathname(filename) + command.name);
                 else
-                    materials_filename= std::string(tmp);
+                    materials_filename= command.name;
                 
                 // charge les matieres
                 if(!read_materials_mtl( materials_filename.c_str(), materials ))
-                    break;
+                    return false;
+                if(sources)
+                    sources->push_back(materials_filename);
             }
+            else
+                material_id= materials.find(command.name.c_str());
         }
         
-        else if(line[0] == 'u')
-        {
-           if(sscanf(line, "usemtl %[^\r\n]", tmp) == 1)
-               material_id= materials.find(tmp);
-        }
+        if(i == n)
+            break;
+        
+        // force une matiere par defaut, si necessaire
+        if(material_id == -1)
+            material_id= materials.default_material_index();
+        
+        // indice de la matiere de chaque triangle
+        indices.push_back(material_id);
     }
     
-    fclose(in);
-    
-    if(error)
-        printf("[error] loading materials '%s'...\n%s\n\n", filename, line_buffer);
+    return true;
+}
 
-    return !error;
+bool read_materials( const char *filename, Materials& materials, std::vector<int>& indices )
+{
+    indices.clear();
+    
+    printf("loading materials '%s'...\n", filename);
+    
+    ObjData obj;
+    if(!read_obj(filename, obj) || !obj_materials(filename, obj, materials, indices))
+    {
+        printf("[error] loading materials '%s'...\n", filename);
+        return false;
+    }
+    
+    return true;
 }
 
 
@@ -412,185 +230,207 @@ struct vertex
     vertex( ) : material(-1), position(-1), texcoord(-1), normal(-1) {}
     vertex( const int m, const int p, const int t, const int n ) : material(m), position(p), texcoord(t), normal(n) {}
     
-    // comparaison lexicographique de 2 sommets / des indices de leurs attributs
-    bool operator< ( const vertex& b ) const
+    bool operator== ( const vertex& b ) const
     {
-        if(material != b.material) return material < b.material;
-        if(position != b.position) return position < b.position;
-        if(texcoord != b.texcoord) return texcoord < b.texcoord;
-        if(normal != b.normal) return normal < b.normal;
-        return false;
+        return material == b.material && position == b.position && texcoord == b.texcoord && normal == b.normal;
+    }
+    
+    unsigned hash( ) const
+    {
+        uint64_t h= uint64_t(unsigned(position)) * 0x9e3779b97f4a7c15ull;
+        h^= (uint64_t(unsigned(texcoord)) + (h << 6) + (h >> 2)) * 0xc2b2ae3d27d4eb4full;
+        h^= (uint64_t(unsigned(normal)) + (h << 6) + (h >> 2)) * 0x165667b19e3779f9ull;
+        h^= uint64_t(unsigned(material)) + (h << 6) + (h >> 2);
+        return unsigned(h ^ (h >> 32));
     }
 };
 
-MeshIOData read_meshio_data( const char *filename )
+// table de hachage, adressage ouvert, sondage lineaire : associe un indice a chaque sommet different, dans l'ordre d'insertion.
+// les sommets sont ranges dans un seul tableau, pas d'allocation par sommet, contrairement a std::map.
+class vertex_table
 {
-    FILE *in= fopen(filename, "rt");
-    if(!in)
+public:
+    explicit vertex_table( const size_t n ) : m_slots(), m_mask(0), m_size(0)
     {
-        printf("[error] loading indexed mesh '%s'...\n", filename);
-        return {};
+        size_t capacity= 16;
+        while(capacity < 2*n)
+            capacity*= 2;
+        m_slots.resize(capacity);
+        m_mask= capacity -1;
     }
     
-    printf("loading indexed mesh '%s'...\n", filename);
-    
-    MeshIOData data;
-    
-    std::vector<Point> wpositions;
-    std::vector<Point> wtexcoords;
-    std::vector<Vector> wnormals;
-    
-    std::vector<int> wp;
-    std::vector<int> wt;
-    std::vector<int> wn;
-    
-    std::map<vertex, int> remap;
-    int material_id= -1;
-    
-    char tmp[1024];
-    char line_buffer[1024];
-    bool error= true;
-    for(;;)
+    // renvoie l'indice du sommet, et vrai s'il vient d'etre insere.
+    std::pair<int, bool> insert( const vertex& v )
     {
-        // charge une ligne du fichier
-        if(!fgets(line_buffer, sizeof(line_buffer), in))
-        {
-            error= false;       // fin du fichier, pas d'erreur detectee
-            break;
-        }
-        
-        // force la fin de la ligne, au cas ou
-        line_buffer[sizeof(line_buffer) -1]= 0;
+        // au plus 1/2 des cases occupees
+        if(2*(m_size +1) > m_slots.size())
+            grow();
         
-        // saute les espaces en debut de ligne
-        char *line= line_buffer;
-        while(*line && isspace(*line))
-            line++;
-        
-        if(line[0] == 'v')
+        for(size_t i= v.hash() & m_mask; ; i= (i +1) & m_mask)
         {
-            float x, y, z;
-            if(line[1] == ' ')          // position x y z
-            {
-                if(sscanf(line, "v %f %f %f", &x, &y, &z) != 3)
-                    break;
-                wpositions.push_back( Point(x, y, z) );
-            }
-            else if(line[1] == 'n')     // normal x y z
+            slot& s= m_slots[i];
+            if(s.index < 0)
             {
-                if(sscanf(line, "vn %f %f %f", &x, &y, &z) != 3)
-                    break;
-                wnormals.push_back( Vector(x, y, z) );
-            }
-            else if(line[1] == 't')     // texcoord x y
-            {
-                if(sscanf(line, "vt %f %f", &x, &y) != 2)
-                    break;
-                wtexcoords.push_back( Point(x, y, 0) );
+                s.key= v;
+                s.index= int(m_size++);
+                return std::make_pair(s.index, true);
             }
+            if(s.key == v)
+                return std::make_pair(s.index, false);
         }
-        else if(line[0] == 'f')         // triangle a b c, les sommets sont numerotes a partir de 1 ou de la fin du tableau (< 0)
+    }
+    
+    size_t size( ) const { return m_size; }
+    
+protected:
+    struct slot
+    {
+        vertex key;
+        int index= -1;       // case vide
+    };
+    
+    void grow( )
+    {
+        std::vector<slot> slots(2 * m_slots.size());
+        size_t mask= slots.size() -1;
+        for(const slot& s : m_slots)
         {
-            wp.clear();
-            wt.clear();
-            wn.clear();
+            if(s.index < 0)
+                continue;
             
-            int next;
-            for(line= line +1; ; line= line + next)
-            {
-                wp.push_back(0); 
-                wt.push_back(0); 
-                wn.push_back(0);         // 0: invalid index
-                
-                // analyse les attributs du sommet : p/t/n ou p//n ou p/t ou p...
-                next= 0;
-                if(sscanf(line, " %d/%d/%d %n", &wp.back(), &wt.back(), &wn.back(), &next) == 3) 
-                    continue;
-                else if(sscanf(line, " %d/%d %n", &wp.back(), &wt.back(), &next) == 2)
-                    continue;
-                else if(sscanf(line, " %d//%d %n", &wp.back(), &wn.back(), &next) == 2)
-                    continue;
-                else if(sscanf(line, " %d %n", &wp.back(), &next) == 1)
-                    continue;
-                else if(next == 0)      // fin de ligne
-                    break;
-            }
-            
-            // force une matiere par defaut, si necessaire
-            if(material_id == -1)
-                material_id= data.materials.default_material_index();
-            
-            // triangule la face
-            for(unsigned v= 2; v +1 < wp.size(); v++)
-            {
-                data.material_indices.push_back(material_id);
-                
-                unsigned idv[3]= { 0, v -1, v };
-                for(unsigned i= 0; i < 3; i++)
-                {
-                    unsigned k= idv[i];
-                    // indices des attributs du sommet
-                    int p= (wp[k] < 0) ? wpositions.size() + wp[k] : wp[k] -1;
-                    int t= (wt[k] < 0) ? wtexcoords.size() + wt[k] : wt[k] -1;
-                    int n= (wn[k] < 0) ? wnormals.size()   + wn[k] : wn[k] -1;
-                    
-                    if(p < 0) break; // error
-                    
-                    // recherche / insere le sommet 
-                    auto found= remap.insert( std::make_pair(vertex(material_id, p, t, n), int(remap.size())) );
-                    if(found.second)
-                    {
-                        // pas trouve, copie les nouveaux attributs
-                        if(t != -1) data.texcoords.push_back(wtexcoords[t]);
-                        if(n != -1) data.normals.push_back(wnormals[n]);
-                        data.positions.push_back(wpositions[p]);
-                    }
-                    
-                    // construit l'index buffer
-                    assert(found.first->second < int(data.positions.size()));
-                    data.indices.push_back(found.first->second);
-                }
-            }
+            size_t i= s.key.hash() & mask;
+            while(slots[i].index >= 0)
+                i= (i +1) & mask;
+            slots[i]= s;
         }
         
-        else if(line[0] == 'm')
+        m_slots.swap(slots);
+        m_mask= mask;
+    }
+    
+    std::vector<slot> m_slots;
+    size_t m_mask;
+    size_t m_size;
+};
+
+// construit l'index buffer des triangles de obj, les sommets qui partagent tous leurs attributs et leur matiere ne sont stockes qu'une fois.
+// data.material_indices contient deja la matiere de chaque triangle, cf obj_materials().
+static void index_vertices( const ObjData& obj, MeshIOData& data )
+{
+    const int count= obj.triangle_count();
+    vertex_table remap(std::min(obj.positions.size(), size_t(3) * count));
+    for(int i= 0; i < count; i++)
+    {
+        int material_id= data.material_indices[i];
+        for(int k= 0; k < 3; k++)
         {
-            if(sscanf(line, "mtllib %[^\r\n]", tmp) == 1)
+            // indices des attributs du sommet
+            const int *v= obj.vertices.data() + 9*i + 3*k;
+            int p= v[0];
+            int t= v[1];
+            int n= v[2];
+            
+            // recherche / insere le sommet 
+            std::pair<int, bool> found= remap.insert( vertex(material_id, p, t, n) );
+            if(found.second)
             {
-                std::string materials_filename;
-                if(tmp[0] != '/' && tmp[1] != ':')   // windows c:\ pour les chemins complets...
-                    materials_filename= normalize_filename(pathname(filename) + tmp);
-                else
-                    materials_filename= std::string(tmp);
-                
-                // charge les matieres
-                if(!read_materials_mtl( materials_filename.c_str(), data.materials ))
-                    break;
+                // pas trouve, copie les nouveaux attributs
+                if(t != -1) data.texcoords.push_back(obj.texcoords[t]);
+                if(n != -1) data.normals.push_back(obj.normals[n]);
+                data.positions.push_back(obj.positions[p]);
             }
+            
+            // construit l'index buffer
+            assert(found.first < int(data.positions.size()));
+            data.indices.push_back(found.first);
         }
-        
-        else if(line[0] == 'u')
+    }
+}
+
+MeshIOData read_meshio_data( const char *filename, const bool cache, const char *cache_directory )
+{
+    printf("loading indexed mesh '%s'...\n", filename);
+    
+    MeshIOData data;
+    std::string cache_filename;
+    if(cache)
+    {
+        cache_filename= mesh_cache_filename(filename, cache_directory);
+        if(read_mesh_cache(cache_filename.c_str(), filename, data))
         {
-           if(sscanf(line, "usemtl %[^\r\n]", tmp) == 1)
-               material_id= data.materials.find(tmp);
+            printf("  cache '%s'\n", cache_filename.c_str());
+            printf("  %d indices, %d positions %d texcoords %d normals\n", 
+                int(data.indices.size()), int(data.positions.size()), int(data.texcoords.size()), int(data.normals.size()));
+            printf("  %d materials, %d textures\n", data.materials.count(), data.materials.filename_count());
+            return data;
         }
     }
     
-    fclose(in);
-    
-    if(error)
+    ObjData obj;
+    std::vector<std::string> sources= { filename };
+    if(!read_obj(filename, obj) || !obj_materials(filename, obj, data.materials, data.material_indices, &sources))
     {
-        printf("[error] loading indexed mesh '%s'...\n%s\n\n", filename, line_buffer);
+        printf("[error] loading indexed mesh '%s'...\n", filename);
         return {};
     }
-
+    
+    index_vertices(obj, data);
+    
     printf("  %d indices, %d positions %d texcoords %d normals\n", 
         int(data.indices.size()), int(data.positions.size()), int(data.texcoords.size()), int(data.normals.size()));
     printf("  %d materials, %d textures\n", data.materials.count(), data.materials.filename_count());
+    
+    // pas grave si le cache ne peut pas etre ecrit, l'objet sera analyse au prochain chargement
+    if(cache)
+        write_mesh_cache(cache_filename.c_str(), data, sources);
     return data;
 }
 
 
+bool read_meshio_batches( const char *filename, const std::function<bool (const MeshIOData& batch)>& callback, const int batch_size )
+{
+    printf("loading indexed mesh '%s' by batches...\n", filename);
+    
+    MeshIOData batch;
+    Materials materials;        // matieres chargees par les groupes precedents
+    bool error= false;
+    int batches= 0;
+    bool complete= read_obj_batches(filename, 
+        [&]( const ObjData& obj )
+        {
+            batch.positions.clear();
+            batch.texcoords.clear();
+            batch.normals.clear();
+            batch.indices.clear();
+            batch.material_indices.clear();
+            
+            batch.materials= std::move(materials);
+            if(!obj_materials(filename, obj, batch.materials, batch.material_indices))
+            {
+                error= true;
+                return false;
+            }
+            
+            index_vertices(obj, batch);
+            bool next= batch.indices.empty() || callback(batch);
+            materials= std::move(batch.materials);
+            batches++;
+            return next;
+        },
+        batch_size);
+    
+    if(!complete)
+    {
+        if(error)
+            printf("[error] loading indexed mesh '%s'...\n", filename);
+        return false;
+    }
+    
+    printf("  %d batches, %d materials, %d textures\n", batches, materials.count(), materials.filename_count());
+    return true;
+}
+
+
 bool read_images( const Materials& materials, std::vector<Image>& images )
 {
     int n= materials.filename_count();
@@ -610,6 +450,39 @@ bool read_images( const Materials& materials, std::vector<Image>& images )
 }
 
 
+bool read_images( const Materials& materials, std::vector<ImageRGBA8>& images )
+{
+    int n= materials.filename_count();
+    if(n == 0)  // pas de textures
+        return true;
+    
+    images.resize(n);
+    
+#pragma omp parallel for
+    for(int i= 0; i < n; i++)
+        images[i]= read_image_rgba8(materials.filename(i));
+    
+    return true;
+}
+
+
+bool read_images( const Materials& materials, std::vector<MipmapRGBA8>& images )
+{
+    int n= materials.filename_count();
+    if(n == 0)  // pas de textures
+        return true;
+    
+    images.resize(n);
+    
+    // une texture par thread, les niveaux d'une texture sont aussi construits en parallele, si les threads imbriques sont actives
+#pragma omp parallel for schedule(dynamic, 1)
+    for(int i= 0; i < n; i++)
+        images[i].build( read_image_rgba8(materials.filename(i)) );
+    
+    return true;
+}
+
+
 bool read_images( MeshIOData& data )
 {
     return read_images(data.materials, data.images);
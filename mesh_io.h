@@ -3,10 +3,13 @@
 #define _MESH_IO_H
 
 #include <vector>
+#include <functional>
 
 #include "vec.h"
 #include "materials.h"
 #include "image.h"
+#include "image_formats.h"
+#include "mipmap.h"
 #include "files.h"
 
 //! \addtogroup objet3D utilitaires pour manipuler des objets 3d
@@ -156,6 +159,11 @@ exemple :
 */
 bool read_images( const Materials& materials, std::vector<Image>& images );
 
+//! charge les textures referencees par les matieres d'un objet, en 8 bits rgba, 4 octets par pixel au lieu de 16, cf read_image_rgba8() et ImageT::texture().
+bool read_images( const Materials& materials, std::vector<ImageRGBA8>& images );
+//! charge les textures referencees par les matieres d'un objet, en 8 bits rgba, et construit leurs mipmaps, en parallele, cf MipmapT.
+bool read_images( const Materials& materials, std::vector<MipmapRGBA8>& images );
+
 
 struct MeshIOData
 {
@@ -166,7 +174,7 @@ struct MeshIOData
     std::vector<int> material_indices;
     
     Materials materials;
-    std::vector<Image> images;
+    std::vector<MipmapRGBA8> images;    //!< textures, en 8 bits rgba, et leurs mipmaps, cf read_images().
 };
 
 /*! charge tous les attributs et les matieres. en une seule fois.
@@ -204,15 +212,37 @@ utiliser read_meshio_data() est equivalent a :
     std::vector<int> material_indices;
     read_materials( filename, materials, materials_indices );
 
-    std::vector<Image> images;
-    read_images( filename, images );
+    std::vector<MipmapRGBA8> images;
+    read_images( materials, images );
 \endcode
 
     mais toutes les infos sont chargees en seule fois, et sont stockees dans une seule structure, cf MeshIOData, plus simple a manipuler.
+
+    cache : l'objet est aussi enregistre dans un fichier binaire, "objet.obj.cache", a cote du fichier .obj, ou dans le repertoire cache_directory, s'il est defini, cf mesh_cache_filename().
+    les chargements suivants relisent directement ce fichier, tant que les fichiers .obj et .mtl ne sont pas modifies, cf read_mesh_cache().
+*/
+MeshIOData read_meshio_data( const char *filename, const bool cache= true, const char *cache_directory= nullptr );
+
+/*! charge un objet par groupes d'au plus batch_size triangles, pour les objets trop gros pour read_meshio_data(), cf read_obj_batches().
+    callback( batch ) est appele pour chaque groupe, dans l'ordre du fichier, et renvoie faux pour interrompre le chargement.
+    batch a la meme organisation que le resultat de read_meshio_data() : les sommets sont partages a l'interieur d'un groupe, et indexes a partir de 0.
+    batch.materials contient les matieres chargees jusqu'a present, les indices de matieres restent valides pour les groupes suivants. les images ne sont pas chargees.
+    
+    la memoire utilisee est limitee aux attributs du fichier, a un groupe, et a ce que callback conserve, par exemple :
+\code
+    Scene scene;
+    read_meshio_batches( "data/scan.obj", 
+        [&]( const MeshIOData& batch ) 
+        {
+            scene.add_mesh(batch);
+            return true;
+        } );
+    scene.build();
+\endcode
 */
-MeshIOData read_meshio_data( const char *filename );
+bool read_meshio_batches( const char *filename, const std::function<bool (const MeshIOData& batch)>& callback, const int batch_size= 65536 );
 
-//! charge les images referencees par les matieres de l'objet. 
+//! charge les images referencees par les matieres de l'objet, et construit leurs mipmaps. toutes les textures restent en memoire, cf Scene::load_textures() et TextureCache pour les charger a la demande.
 bool read_images( MeshIOData& data );
 
 ///@}
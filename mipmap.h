@@ -0,0 +1,148 @@
+
+#ifndef _MIPMAP_H
+#define _MIPMAP_H
+
+#include <cmath>
+#include <cassert>
+#include <vector>
+#include <algorithm>
+#include <utility>
+#include <type_traits>
+
+#include "color.h"
+#include "image_formats.h"
+
+// les niveaux sont deplaces, et pas copies, cf ImageT( ImageT&& )
+static_assert(std::is_nothrow_move_constructible< ImageT<RGBA8> >::value, "ImageT move");
+
+
+//! \addtogroup image
+///@{
+
+//! \file
+//! textures filtrees : pyramides d'images (mipmaps), interpolation trilineaire et choix du niveau de detail par cone de rayon.
+
+/*! pyramide d'images : le niveau 0 est l'image, chaque niveau suivant est 2 fois plus petit, jusqu'a 1x1 pixel.
+    les niveaux sont construits en parallele, cf build(). le stockage supplementaire est 1/3 de celui de l'image.
+    les lectures loin de la camera utilisent les petits niveaux, qui restent dans les caches, et ne produisent pas d'aliasing.
+    \code
+    MipmapRGBA8 texture( read_image_rgba8("data/texture.png") );
+    float lod= ray_cone_lod(width, cos_theta, triangle_area, texcoord_area, texture.width(), texture.height());
+    Color color= texture.texture(u, v, lod);
+    \endcode
+*/
+template < typename Pixel >
+class MipmapT
+{
+protected:
+    std::vector< ImageT<Pixel> > m_levels;
+
+public:
+    MipmapT( ) : m_levels() {}
+    //! construit la pyramide d'une image.
+    explicit MipmapT( ImageT<Pixel> image ) : m_levels() { build(std::move(image)); }
+
+    /*! construit la pyramide d'une image. chaque pixel d'un niveau est la moyenne de 4 pixels du niveau precedent,
+        la derniere ligne / colonne d'un niveau de taille impaire n'est pas utilisee. les lignes d'un niveau sont calculees en parallele.
+        l'image devient le niveau 0, sans copie si elle est deplacee, par exemple build( read_image_rgba8(filename) ).
+    */
+    void build( ImageT<Pixel> image )
+    {
+        m_levels.clear();
+        if(image.size() == 0)
+            return;
+
+        // nombre de niveaux, les niveaux ne sont pas deplaces pendant la construction
+        int n= 1;
+        for(int w= image.width(), h= image.height(); w > 1 || h > 1; n++)
+        {
+            w= std::max(1, w / 2);
+            h= std::max(1, h / 2);
+        }
+        m_levels.reserve(n);
+
+        const bool adopted= image.adopted();
+        m_levels.push_back(std::move(image));
+        while(m_levels.back().width() > 1 || m_levels.back().height() > 1)
+        {
+            const ImageT<Pixel>& source= m_levels.back();
+            ImageT<Pixel> level(std::max(1, source.width() / 2), std::max(1, source.height() / 2));
+
+            #pragma omp parallel for schedule(static)
+            for(int y= 0; y < level.height(); y++)
+            for(int x= 0; x < level.width(); x++)
+            {
+                Color color= source.color(2*x, 2*y) + source.color(2*x+1, 2*y) + source.color(2*x, 2*y+1) + source.color(2*x+1, 2*y+1);
+                level(x, y)= Pixel(color * float(0.25));
+            }
+
+            m_levels.push_back(std::move(level));
+        }
+
+        // le niveau 0 utilise toujours les pixels de l'image, sans copie
+        assert(m_levels[0].adopted() == adopted);
+        assert(int(m_levels.size()) == n);
+        (void) adopted;
+    }
+
+    //! renvoie le nombre de niveaux.
+    int levels( ) const { return int(m_levels.size()); }
+    //! renvoie un niveau de la pyramide, 0 pour l'image complete.
+    const ImageT<Pixel>& level( const int lod ) const { assert(lod >= 0 && lod < levels()); return m_levels[lod]; }
+
+    //! renvoie la largeur de l'image, niveau 0.
+    int width( ) const { return m_levels.empty() ? 0 : m_levels[0].width(); }
+    //! renvoie la hauteur de l'image, niveau 0.
+    int height( ) const { return m_levels.empty() ? 0 : m_levels[0].height(); }
+    //! renvoie la taille de tous les niveaux, en octets.
+    size_t bytes( ) const
+    {
+        size_t n= 0;
+        for(const auto& level : m_levels)
+            n+= level.bytes();
+        return n;
+    }
+
+    //! renvoie la couleur interpolee (bilineaire) aux coordonnees normalisees (x, y) [0 .. 1]x[0 .. 1] d'un niveau. les centres des pixels sont alignes sur tous les niveaux.
+    Color texture_level( const float x, const float y, const int lod ) const
+    {
+        const ImageT<Pixel>& image= m_levels[std::max(0, std::min(lod, levels() -1))];
+        return image.sample(x * image.width() - float(0.5), y * image.height() - float(0.5));
+    }
+
+    //! renvoie la couleur interpolee (trilineaire) aux coordonnees normalisees (x, y) : entre les 2 niveaux les plus proches de lod, qui n'est pas forcement entier.
+    Color texture( const float x, const float y, const float lod ) const
+    {
+        assert(!m_levels.empty());
+        float l= std::max(float(0), std::min(lod, float(levels() -1)));
+        int l0= int(l);
+        float f= l - float(l0);
+        if(f == 0 || l0 +1 >= levels())
+            return texture_level(x, y, l0);
+
+        return texture_level(x, y, l0) * (1 - f) + texture_level(x, y, l0 +1) * f;
+    }
+};
+
+typedef MipmapT<RGB8> MipmapRGB8;
+typedef MipmapT<RGBA8> MipmapRGBA8;
+typedef MipmapT<RGB16F> MipmapRGB16F;
+typedef MipmapT<RGB32F> MipmapRGB32F;
+
+
+/*! niveau de detail d'une texture width x height pour un cone de rayon, cf "texture level of detail strategies for real-time ray tracing", Akenine-Moller et al, ray tracing gems 2019.
+    cone_width : largeur du cone a l'intersection, cf Camera::spread, cos_theta : cosinus entre la direction du rayon et la normale du triangle,
+    triangle_area et texcoord_area : aires du triangle, dans la scene, et dans l'espace des coordonnees de texture [0 .. 1]x[0 .. 1].
+*/
+inline float ray_cone_lod( const float cone_width, const float cos_theta, const float triangle_area, const float texcoord_area, const int width, const int height )
+{
+    if(triangle_area <= 0 || texcoord_area <= 0 || cone_width <= 0)
+        return 0;
+
+    // rapport des aires texels / scene, + projection du cone sur le triangle
+    float lod= float(0.5) * std::log2(float(width) * float(height) * texcoord_area / triangle_area);
+    return lod + std::log2(cone_width / std::max(std::abs(cos_theta), float(1e-4)));
+}
+
+///@}
+#endif
@@ -0,0 +1,535 @@
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstdint>
+#include <cstring>
+#include <cassert>
+#include <algorithm>
+
+#include "obj_parser.h"
+#include "mapped_file.h"
+
+
+namespace {
+
+// taille des blocs de lignes analyses par un thread, le decoupage ne depend pas du nombre de threads
+const size_t OBJ_CHUNK= size_t(8) * 1024 * 1024;
+
+// nombre de blocs analyses en parallele par read_obj_batches()
+const int OBJ_WINDOW= 8;
+
+// resultat de l'analyse d'un bloc de lignes. les indices negatifs sont relatifs aux attributs du bloc, ils sont corriges par read_obj() lorsque le nombre d'attributs des blocs precedents est connu.
+struct ObjChunk
+{
+    std::vector<Point> positions;
+    std::vector<Point> texcoords;
+    std::vector<Vector> normals;
+    std::vector<int> vertices;
+    std::vector<int> relative;          // indices dans vertices des indices relatifs, slot % 3 : position, texcoord, normale
+    std::vector<ObjCommand> commands;   // ObjCommand::triangle est l'indice du triangle dans le bloc
+
+    const char *error= nullptr;         // debut de la ligne incorrecte, ou nullptr
+};
+
+inline bool blank( const char c ) { return c == ' ' || c == '\t' || c == '\r' || c == '\f' || c == '\v'; }
+inline bool digit( const char c ) { return c >= '0' && c <= '9'; }
+
+const char *skip_blanks( const char *s, const char *end )
+{
+    while(s < end && blank(*s))
+        s++;
+    return s;
+}
+
+const char *end_of_line( const char *s, const char *end )
+{
+    const char *eol= (const char *) memchr(s, '\n', end - s);
+    return eol ? eol : end;
+}
+
+const double powers10[]= { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+
+/* lit un float, comme strtof(). renvoie la position du caractere suivant, ou nullptr s'il n'y a pas de nombre.
+    les nombres usuels, au plus 15 chiffres significatifs et un exposant <= 22, sont calcules directement en double, sans erreur, puis arrondis en float.
+    sinon : inf, nan, nombres tres longs ou exposants importants, le nombre est lu par strtof().
+ */
+const char *parse_float( const char *s, const char *end, float& value )
+{
+    const char *begin= s;
+    bool negative= false;
+    if(s < end && (*s == '-' || *s == '+'))
+    {
+        negative= (*s == '-');
+        s++;
+    }
+
+    uint64_t mantissa= 0;
+    int digits= 0;      // chiffres significatifs
+    int exponent= 0;
+    bool number= false;
+    for(; s < end && digit(*s); s++)
+    {
+        number= true;
+        if(mantissa == 0 && *s == '0')
+            continue;
+        if(digits < 19) { mantissa= mantissa * 10 + (*s - '0'); digits++; }
+        else exponent++;
+    }
+    if(s < end && *s == '.')
+    {
+        for(s++; s < end && digit(*s); s++)
+        {
+            number= true;
+            if(mantissa == 0 && *s == '0') { exponent--; continue; }
+            if(digits < 19) { mantissa= mantissa * 10 + (*s - '0'); digits++; exponent--; }
+        }
+    }
+
+    if(!number)
+    {
+        // inf, nan, ou pas de nombre
+        if(s < end && (*s == 'i' || *s == 'I' || *s == 'n' || *s == 'N'))
+            goto slow;
+        return nullptr;
+    }
+
+    if(s < end && (*s == 'e' || *s == 'E'))
+    {
+        const char *e= s +1;
+        bool eneg= false;
+        if(e < end && (*e == '-' || *e == '+'))
+        {
+            eneg= (*e == '-');
+            e++;
+        }
+        if(e < end && digit(*e))
+        {
+            int x= 0;
+            for(; e < end && digit(*e); e++)
+                if(x < 100000) x= x * 10 + (*e - '0');
+            exponent+= eneg ? -x : x;
+            s= e;
+        }
+    }
+
+    if(digits <= 15 && exponent >= -22 && exponent <= 22)
+    {
+        double d= double(mantissa);
+        d= (exponent < 0) ? d / powers10[-exponent] : d * powers10[exponent];
+        value= float(negative ? -d : d);
+        return s;
+    }
+
+slow:
+    {
+        // copie le nombre, le fichier projete n'est pas termine par un 0
+        char tmp[128];
+        size_t n= std::min(size_t(end - begin), sizeof(tmp) -1);
+        memcpy(tmp, begin, n);
+        tmp[n]= 0;
+
+        char *next= nullptr;
+        value= strtof(tmp, &next);
+        if(next == tmp)
+            return nullptr;
+        return begin + (next - tmp);
+    }
+}
+
+// lit un entier, renvoie la position du caractere suivant, ou nullptr s'il n'y a pas de nombre.
+const char *parse_int( const char *s, const char *end, int& value )
+{
+    bool negative= false;
+    if(s < end && (*s == '-' || *s == '+'))
+    {
+        negative= (*s == '-');
+        s++;
+    }
+
+    if(s >= end || !digit(*s))
+        return nullptr;
+
+    int64_t x= 0;
+    for(; s < end && digit(*s); s++)
+        if(x < INT32_MAX) x= x * 10 + (*s - '0');
+
+    x= std::min<int64_t>(x, INT32_MAX);
+    value= int(negative ? -x : x);
+    return s;
+}
+
+// lit n floats separes par des espaces, comme sscanf(" %f %f %f"), la suite de la ligne est ignoree
+bool parse_floats( const char *s, const char *end, float *values, const int n )
+{
+    for(int i= 0; i < n; i++)
+    {
+        s= skip_blanks(s, end);
+        s= parse_float(s, end, values[i]);
+        if(!s)
+            return false;
+    }
+    return true;
+}
+
+// fin de la ligne, sans les espaces du debut, ni \r \n, comme sscanf(" %[^\r\n]")
+std::string parse_name( const char *s, const char *end )
+{
+    s= skip_blanks(s, end);
+    const char *e= s;
+    while(e < end && *e != '\r' && *e != '\n')
+        e++;
+    return std::string(s, e);
+}
+
+// resout l'indice d'un attribut d'un sommet : a partir de 1, ou negatif, relatif a la fin du tableau. 0 : pas d'attribut.
+inline void vertex_index( ObjChunk& chunk, const int index, const int count, const int slot )
+{
+    if(index > 0)
+        chunk.vertices.push_back(index -1);
+    else if(index < 0)
+    {
+        // relatif aux attributs du bloc, corrige lors de l'assemblage
+        chunk.relative.push_back(slot);
+        chunk.vertices.push_back(count + index);
+    }
+    else
+        chunk.vertices.push_back(-1);
+}
+
+// analyse une face : sommets p, p/t, p//n ou p/t/n, s'arrete sur le premier sommet incorrect, comme les sscanf() de la version precedente.
+bool parse_face( ObjChunk& chunk, const char *s, const char *end, std::vector<int>& face )
+{
+    face.clear();
+    for(;;)
+    {
+        s= skip_blanks(s, end);
+
+        int p= 0, t= 0, n= 0;
+        const char *next= parse_int(s, end, p);
+        if(!next)
+            break;
+        if(next < end && *next == '/')
+        {
+            if(next +1 < end && next[1] == '/')
+                next= parse_int(next +2, end, n);
+            else
+            {
+                next= parse_int(next +1, end, t);
+                if(next && next < end && *next == '/')
+                    next= parse_int(next +1, end, n);
+            }
+            if(!next)
+                break;
+        }
+        if(next < end && !blank(*next))
+            break;
+
+        face.push_back(p);
+        face.push_back(t);
+        face.push_back(n);
+        s= next;
+    }
+
+    // triangule la face
+    const int count= int(face.size() / 3);
+    for(int v= 2; v < count; v++)
+    {
+        const int idv[3]= { 0, v -1, v };
+        for(int i= 0; i < 3; i++)
+        {
+            const int *vertex= face.data() + 3 * idv[i];
+            if(vertex[0] == 0)
+                return false;       // pas de position
+
+            vertex_index(chunk, vertex[0], int(chunk.positions.size()), int(chunk.vertices.size()));
+            vertex_index(chunk, vertex[1], int(chunk.texcoords.size()), int(chunk.vertices.size()));
+            vertex_index(chunk, vertex[2], int(chunk.normals.size()), int(chunk.vertices.size()));
+        }
+    }
+
+    return true;
+}
+
+bool starts_with( const char *s, const char *end, const char *keyword )
+{
+    size_t n= strlen(keyword);
+    return size_t(end - s) > n && memcmp(s, keyword, n) == 0 && blank(s[n]);
+}
+
+// decoupe le fichier en blocs de lignes completes, renvoie le debut de chaque bloc, et la fin du fichier
+std::vector<const char *> chunk_bounds( const char *begin, const char *end )
+{
+    std::vector<const char *> bounds;
+    bounds.push_back(begin);
+    for(const char *s= begin + OBJ_CHUNK; s < end; s+= OBJ_CHUNK)
+    {
+        const char *eol= end_of_line(std::max(s, bounds.back()), end);
+        if(eol >= end)
+            break;
+        bounds.push_back(eol + 1);
+        s= eol + 1;
+    }
+    bounds.push_back(end);
+    return bounds;
+}
+
+void parse_chunk( const char *begin, const char *end, ObjChunk& chunk )
+{
+    std::vector<int> face;
+    float v[3];
+    for(const char *line= begin; line < end; )
+    {
+        const char *eol= end_of_line(line, end);
+        const char *s= skip_blanks(line, eol);
+
+        bool ok= true;
+        if(s + 1 < eol && s[0] == 'v')
+        {
+            if(blank(s[1]))                 // position x y z
+            {
+                ok= parse_floats(s + 1, eol, v, 3);
+                chunk.positions.push_back( Point(v[0], v[1], v[2]) );
+            }
+            else if(s[1] == 'n')            // normale x y z
+            {
+                ok= parse_floats(s + 2, eol, v, 3);
+                chunk.normals.push_back( Vector(v[0], v[1], v[2]) );
+            }
+            else if(s[1] == 't')            // texcoord x y
+            {
+                ok= parse_floats(s + 2, eol, v, 2);
+                chunk.texcoords.push_back( Point(v[0], v[1], 0) );
+            }
+        }
+        else if(s < eol && s[0] == 'f' && (s + 1 == eol || blank(s[1])))
+            ok= parse_face(chunk, s + 1, eol, face);
+
+        else if(starts_with(s, eol, "mtllib") || starts_with(s, eol, "usemtl"))
+        {
+            // ignore les commandes sans nom, comme sscanf(" %[^\r\n]") : usemtl sans nom conserve la matiere courante
+            std::string name= parse_name(s + 6, eol);
+            if(!name.empty())
+                chunk.commands.push_back( { int(chunk.vertices.size() / 9), s[0] == 'm', name } );
+        }
+
+        if(!ok)
+        {
+            chunk.error= line;
+            return;
+        }
+
+        line= eol + 1;
+    }
+}
+
+}
+
+
+bool read_obj( const char *filename, ObjData& data )
+{
+    data= ObjData();
+
+    std::shared_ptr<MappedFile> file= map_file(filename);
+    if(!file)
+        return false;
+
+    const char *begin= file->data();
+    const char *end= begin + file->size();
+    std::vector<const char *> bounds= chunk_bounds(begin, end);
+
+    // analyse les blocs, en parallele
+    const int n= int(bounds.size()) -1;
+    std::vector<ObjChunk> chunks(n);
+    #pragma omp parallel for schedule(dynamic, 1)
+    for(int i= 0; i < n; i++)
+        parse_chunk(bounds[i], bounds[i +1], chunks[i]);
+
+    for(int i= 0; i < n; i++)
+    {
+        if(chunks[i].error)
+        {
+            const char *line= chunks[i].error;
+            printf("[error] loading obj '%s'...\n%s\n\n", filename, std::string(line, end_of_line(line, end)).c_str());
+            return false;
+        }
+    }
+
+    // position des attributs de chaque bloc dans les tableaux complets
+    std::vector<size_t> positions(n +1, 0), texcoords(n +1, 0), normals(n +1, 0), vertices(n +1, 0);
+    for(int i= 0; i < n; i++)
+    {
+        positions[i +1]= positions[i] + chunks[i].positions.size();
+        texcoords[i +1]= texcoords[i] + chunks[i].texcoords.size();
+        normals[i +1]= normals[i] + chunks[i].normals.size();
+        vertices[i +1]= vertices[i] + chunks[i].vertices.size();
+    }
+    if(positions[n] > size_t(INT32_MAX) || vertices[n] > size_t(INT32_MAX))
+    {
+        printf("[error] loading obj '%s': too many vertices...\n", filename);
+        return false;
+    }
+
+    data.positions.resize(positions[n]);
+    data.texcoords.resize(texcoords[n]);
+    data.normals.resize(normals[n]);
+    data.vertices.resize(vertices[n]);
+
+    for(int i= 0; i < n; i++)
+    for(const ObjCommand& command : chunks[i].commands)
+        data.commands.push_back( { command.triangle + int(vertices[i] / 9), command.mtllib, command.name } );
+
+    // rassemble les blocs, en parallele, et corrige les indices relatifs
+    bool error= false;
+    #pragma omp parallel for schedule(dynamic, 1) reduction(||: error)
+    for(int i= 0; i < n; i++)
+    {
+        ObjChunk& chunk= chunks[i];
+        std::copy(chunk.positions.begin(), chunk.positions.end(), data.positions.begin() + positions[i]);
+        std::copy(chunk.texcoords.begin(), chunk.texcoords.end(), data.texcoords.begin() + texcoords[i]);
+        std::copy(chunk.normals.begin(), chunk.normals.end(), data.normals.begin() + normals[i]);
+
+        for(int slot : chunk.relative)
+        {
+            const size_t *offsets[3]= { positions.data(), texcoords.data(), normals.data() };
+            chunk.vertices[slot]+= int(offsets[slot % 3][i]);
+        }
+
+        int *out= data.vertices.data() + vertices[i];
+        const int counts[3]= { int(positions[n]), int(texcoords[n]), int(normals[n]) };
+        for(size_t k= 0; k < chunk.vertices.size(); k++)
+        {
+            int index= chunk.vertices[k];
+            // la position doit exister, texcoord et normale sont optionnelles
+            if(index >= counts[k % 3] || (index < 0 && (k % 3 == 0 || index != -1)))
+                error= true;
+            out[k]= index;
+        }
+
+        // libere le bloc
+        chunk= ObjChunk();
+    }
+
+    if(error)
+    {
+        printf("[error] loading obj '%s': invalid vertex index...\n", filename);
+        return false;
+    }
+
+    return true;
+}
+
+
+bool read_obj_batches( const char *filename, const std::function<bool (const ObjData& data)>& callback, const int batch_size )
+{
+    assert(batch_size > 0);
+
+    std::shared_ptr<MappedFile> file= map_file(filename);
+    if(!file)
+        return false;
+
+    const char *begin= file->data();
+    const char *end= begin + file->size();
+    std::vector<const char *> bounds= chunk_bounds(begin, end);
+    const int n= int(bounds.size()) -1;
+
+    ObjData data;
+    std::string material;       // derniere commande usemtl, repetee au debut de chaque groupe
+
+    // transmet le groupe et prepare le suivant
+    auto emit= [&]( ) -> bool
+    {
+        if(!callback(data))
+            return false;
+
+        data.first+= data.triangle_count();
+        data.vertices.clear();
+        data.commands.clear();
+        if(!material.empty())
+            data.commands.push_back( { 0, false, material } );
+        return true;
+    };
+
+    std::vector<ObjChunk> chunks;
+    for(int w= 0; w < n; w+= OBJ_WINDOW)
+    {
+        // analyse une fenetre de blocs, en parallele
+        const int m= std::min(OBJ_WINDOW, n - w);
+        chunks.assign(m, ObjChunk());
+        #pragma omp parallel for schedule(dynamic, 1)
+        for(int i= 0; i < m; i++)
+            parse_chunk(bounds[w + i], bounds[w + i +1], chunks[i]);
+
+        for(int i= 0; i < m; i++)
+        {
+            ObjChunk& chunk= chunks[i];
+            if(chunk.error)
+            {
+                const char *line= chunk.error;
+                printf("[error] loading obj '%s'...\n%s\n\n", filename, std::string(line, end_of_line(line, end)).c_str());
+                return false;
+            }
+
+            // ajoute les attributs du bloc, et corrige les indices relatifs
+            const size_t offsets[3]= { data.positions.size(), data.texcoords.size(), data.normals.size() };
+            data.positions.insert(data.positions.end(), chunk.positions.begin(), chunk.positions.end());
+            data.texcoords.insert(data.texcoords.end(), chunk.texcoords.begin(), chunk.texcoords.end());
+            data.normals.insert(data.normals.end(), chunk.normals.begin(), chunk.normals.end());
+            if(data.positions.size() > size_t(INT32_MAX))
+            {
+                printf("[error] loading obj '%s': too many vertices...\n", filename);
+                return false;
+            }
+
+            for(int slot : chunk.relative)
+                chunk.vertices[slot]+= int(offsets[slot % 3]);
+
+            // les sommets doivent etre definis avant les triangles
+            const int counts[3]= { int(data.positions.size()), int(data.texcoords.size()), int(data.normals.size()) };
+            for(size_t k= 0; k < chunk.vertices.size(); k++)
+            {
+                int index= chunk.vertices[k];
+                if(index >= counts[k % 3] || (index < 0 && (k % 3 == 0 || index != -1)))
+                {
+                    printf("[error] loading obj '%s': invalid vertex index...\n", filename);
+                    return false;
+                }
+            }
+
+            // repartit les triangles du bloc dans les groupes, les commandes restent devant leur premier triangle
+            const int triangles= int(chunk.vertices.size() / 9);
+            size_t next= 0;
+            for(int t= 0; ; )
+            {
+                for(; next < chunk.commands.size() && chunk.commands[next].triangle <= t; next++)
+                {
+                    const ObjCommand& command= chunk.commands[next];
+                    data.commands.push_back( { data.triangle_count(), command.mtllib, command.name } );
+                    if(!command.mtllib)
+                        material= command.name;
+                }
+
+                if(t == triangles)
+                    break;
+
+                int count= std::min(triangles - t, batch_size - data.triangle_count());
+                if(next < chunk.commands.size())
+                    count= std::min(count, chunk.commands[next].triangle - t);
+
+                data.vertices.insert(data.vertices.end(), chunk.vertices.begin() + 9*t, chunk.vertices.begin() + 9*(t + count));
+                t+= count;
+
+                if(data.triangle_count() == batch_size && !emit())
+                    return false;
+            }
+
+            // libere le bloc
+            chunk= ObjChunk();
+        }
+    }
+
+    // dernier groupe, incomplet, ou commandes apres le dernier triangle
+    if(data.triangle_count() > 0 || data.commands.size() > (material.empty() ? 0 : 1))
+        return emit();
+
+    return true;
+}
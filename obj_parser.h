@@ -0,0 +1,58 @@
+
+#ifndef _OBJ_PARSER_H
+#define _OBJ_PARSER_H
+
+#include <string>
+#include <vector>
+#include <functional>
+
+#include "vec.h"
+
+
+//! \file
+//! analyse parallele des fichiers .obj / wavefront, utilisee par read_meshio_data(), read_indexed_positions(), read_positions() et read_materials().
+
+//! commande mtllib ou usemtl d'un fichier .obj, et l'indice du premier triangle qui la suit.
+struct ObjCommand
+{
+    int triangle;
+    bool mtllib;        //!< vrai pour mtllib, faux pour usemtl.
+    std::string name;   //!< nom du fichier de matieres ou de la matiere.
+};
+
+/*! contenu d'un fichier .obj : attributs, triangles et commandes de matieres, dans l'ordre du fichier.
+    les faces sont decoupees en triangles, et les indices des sommets sont resolus : a partir de 0, y compris les indices negatifs, relatifs a la fin des tableaux.
+*/
+struct ObjData
+{
+    std::vector<Point> positions;
+    std::vector<Point> texcoords;       //!< x, y, z = 0
+    std::vector<Vector> normals;
+    std::vector<int> vertices;          //!< 3 sommets par triangle, 3 indices par sommet : position, texcoord, normale. -1 si le sommet n'a pas de texcoord ou de normale.
+    std::vector<ObjCommand> commands;   //!< mtllib et usemtl
+    int first= 0;                       //!< indice dans le fichier du premier triangle de vertices, cf read_obj_batches().
+
+    //! renvoie le nombre de triangles.
+    int triangle_count( ) const { return int(vertices.size() / 9); }
+};
+
+/*! charge un fichier .obj. le fichier est projete en memoire, cf MappedFile, decoupe en blocs de lignes, et les blocs sont analyses en parallele.
+    les resultats des blocs sont ensuite rassembles, en parallele : les indices negatifs d'un bloc peuvent designer des sommets des blocs precedents.
+    renvoie faux en cas d'erreur, et affiche la ligne incorrecte.
+*/
+bool read_obj( const char *filename, ObjData& data );
+
+/*! charge un fichier .obj par groupes d'au plus batch_size triangles, sans garder tous les triangles en memoire, pour les objets trop gros pour read_obj().
+    callback( data ) est appele pour chaque groupe, dans l'ordre du fichier :
+        - data.positions, data.texcoords et data.normals contiennent tous les attributs lus jusqu'a present, les indices des triangles les referencent directement,
+        - data.vertices contient les triangles du groupe, et data.first l'indice de son premier triangle dans le fichier,
+        - data.commands contient les commandes du groupe, ObjCommand::triangle est relatif au groupe. un groupe commence par la derniere commande usemtl des groupes precedents.
+    callback renvoie faux pour interrompre le chargement.
+
+    le fichier est analyse par fenetres de quelques blocs de lignes, en parallele : la memoire utilisee est celle des attributs, d'un groupe et d'une fenetre.
+    contrairement a read_obj(), un triangle ne doit pas referencer de sommets definis apres lui dans le fichier.
+    renvoie faux en cas d'erreur, ou si le chargement a ete interrompu. les groupes precedant l'erreur ont deja ete transmis a callback.
+*/
+bool read_obj_batches( const char *filename, const std::function<bool (const ObjData& data)>& callback, const int batch_size= 65536 );
+
+#endif
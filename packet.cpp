@@ -0,0 +1,470 @@
+
+#include <cmath>
+#include <algorithm>
+
+#include "packet.h"
+#include "simd.h"
+
+
+namespace {
+
+static_assert(PACKET_SIZE % SIMD_WIDTH == 0, "PACKET_SIZE doit etre un multiple de SIMD_WIDTH");
+static_assert(PACKET_SIZE / SIMD_WIDTH <= 64, "trop de groupes de rayons par paquet");
+
+// intervalle [lo .. hi]
+struct Interval
+{
+    float lo, hi;
+};
+
+Interval operator* ( const Interval& a, const Interval& b )
+{
+    float p0= a.lo * b.lo;
+    float p1= a.lo * b.hi;
+    float p2= a.hi * b.lo;
+    float p3= a.hi * b.hi;
+    return { std::min(std::min(p0, p1), std::min(p2, p3)), std::max(std::max(p0, p1), std::max(p2, p3)) };
+}
+
+// donnees partagees par les rayons du paquet pendant le parcours du bvh
+struct PacketTraversal
+{
+    alignas(32) float invdx[PACKET_SIZE];
+    alignas(32) float invdy[PACKET_SIZE];
+    alignas(32) float invdz[PACKET_SIZE];
+    alignas(32) float a[PACKET_SIZE];       // dot(d, d)
+    alignas(32) float inva[PACKET_SIZE];
+
+    // englobant du paquet : intervalles des origines et des inverses des directions, valides si les directions ont le meme signe sur chaque axe
+    Interval o[3];
+    Interval invd[3];
+    bool coherent;
+    // ordre de visite des fils, direction moyenne du paquet
+    Vector mean;
+
+    PacketTraversal( const RayPacket& packet )
+    {
+        coherent= true;
+        for(int k= 0; k < 3; k++)
+        {
+            o[k]= { inf, -inf };
+            invd[k]= { inf, -inf };
+        }
+        mean= Vector(0, 0, 0);
+
+        int active= 0;
+        for(int i= 0; i < PACKET_SIZE; i++)
+        {
+            Vector d= packet.direction(i);
+            invdx[i]= 1 / d.x;
+            invdy[i]= 1 / d.y;
+            invdz[i]= 1 / d.z;
+            a[i]= dot(d, d);
+            inva[i]= 1 / a[i];
+
+            if(packet.tmax[i] < 0)
+                continue;   // rayon inactif
+
+            active++;
+            mean= mean + d;
+            float po[3]= { packet.ox[i], packet.oy[i], packet.oz[i] };
+            float pinvd[3]= { invdx[i], invdy[i], invdz[i] };
+            for(int k= 0; k < 3; k++)
+            {
+                o[k].lo= std::min(o[k].lo, po[k]);
+                o[k].hi= std::max(o[k].hi, po[k]);
+                invd[k].lo= std::min(invd[k].lo, pinvd[k]);
+                invd[k].hi= std::max(invd[k].hi, pinvd[k]);
+            }
+        }
+
+        // l'intervalle des inverses n'est borne que si toutes les directions ont le meme signe
+        for(int k= 0; k < 3; k++)
+            if(active == 0 || !(invd[k].lo > 0 || invd[k].hi < 0) || std::isinf(invd[k].lo) || std::isinf(invd[k].hi))
+                coherent= false;
+    }
+
+    // renvoie faux si aucun rayon du paquet ne peut toucher la boite, test conservatif, independant du nombre de rayons
+    bool may_intersect( const BBox& box, const float tmax ) const
+    {
+        if(!coherent)
+            return true;
+
+        float tnear= 0;
+        float tfar= tmax;
+        float pmin[3]= { box.pmin.x, box.pmin.y, box.pmin.z };
+        float pmax[3]= { box.pmax.x, box.pmax.y, box.pmax.z };
+        for(int k= 0; k < 3; k++)
+        {
+            Interval t0= Interval{ pmin[k] - o[k].hi, pmin[k] - o[k].lo } * invd[k];
+            Interval t1= Interval{ pmax[k] - o[k].hi, pmax[k] - o[k].lo } * invd[k];
+            if(invd[k].hi < 0)
+                std::swap(t0, t1);      // directions negatives, le rayon entre par pmax
+
+            tnear= std::max(tnear, t0.lo);
+            tfar= std::min(tfar, t1.hi);
+        }
+        return tnear <= tfar;
+    }
+};
+
+/* renvoie les groupes de SIMD_WIDTH rayons qui touchent la boite avant leur tmax, le groupe i correspond au bit i / SIMD_WIDTH.
+    s'arrete sur le premier groupe qui touche la boite, sauf si all est vrai.
+ */
+unsigned long long intersect_box( const BBox& box, const RayPacket& packet, const PacketTraversal& traversal, const float *tmax, const bool all )
+{
+    vfloat pminx= vfloat(box.pmin.x), pminy= vfloat(box.pmin.y), pminz= vfloat(box.pmin.z);
+    vfloat pmaxx= vfloat(box.pmax.x), pmaxy= vfloat(box.pmax.y), pmaxz= vfloat(box.pmax.z);
+    vfloat zero= vfloat(0.f);
+
+    unsigned long long groups= 0;
+    for(int i= 0; i < PACKET_SIZE; i+= SIMD_WIDTH)
+    {
+        vfloat ox= vload(packet.ox + i), oy= vload(packet.oy + i), oz= vload(packet.oz + i);
+        vfloat ix= vload(traversal.invdx + i), iy= vload(traversal.invdy + i), iz= vload(traversal.invdz + i);
+
+        vfloat tx0= (pminx - ox) * ix, tx1= (pmaxx - ox) * ix;
+        vfloat ty0= (pminy - oy) * iy, ty1= (pmaxy - oy) * iy;
+        vfloat tz0= (pminz - oz) * iz, tz1= (pmaxz - oz) * iz;
+
+        // rayon parallele a un axe, dans le plan d'une face : 0 * inf = NaN, l'axe ne limite pas l'intervalle, cf BBox::intersect()
+        vbool x= (tx0 <= tx1) | (tx1 <= tx0);
+        vbool y= (ty0 <= ty1) | (ty1 <= ty0);
+        vbool z= (tz0 <= tz1) | (tz1 <= tz0);
+
+        vfloat tfar= vload(tmax + i);
+        vfloat t0= vmax(vmax(vselect(x, vmin(tx0, tx1), zero), vselect(y, vmin(ty0, ty1), zero)), vmax(vselect(z, vmin(tz0, tz1), zero), zero));
+        vfloat t1= vmin(vmin(vselect(x, vmax(tx0, tx1), tfar), vselect(y, vmax(ty0, ty1), tfar)), vmin(vselect(z, vmax(tz0, tz1), tfar), tfar));
+        if(vbits(t0 <= t1))
+        {
+            groups|= 1ull << (i / SIMD_WIDTH);
+            if(!all)
+                break;
+        }
+    }
+
+    return groups;
+}
+
+// intersection des rayons du paquet avec une sphere, renvoie les bits des rayons qui la touchent avant tmax, et les positions dans t
+int intersect_sphere_lanes( const SphereSoA& spheres, const int id, const RayPacket& packet, const PacketTraversal& traversal, const int i, const vfloat tmax, vfloat& t )
+{
+    vfloat ocx= vload(packet.ox + i) - vfloat(spheres.cx[id]);
+    vfloat ocy= vload(packet.oy + i) - vfloat(spheres.cy[id]);
+    vfloat ocz= vload(packet.oz + i) - vfloat(spheres.cz[id]);
+    vfloat dx= vload(packet.dx + i), dy= vload(packet.dy + i), dz= vload(packet.dz + i);
+
+    vfloat b= dx * ocx + dy * ocy + dz * ocz;
+    vfloat k= ocx * ocx + ocy * ocy + ocz * ocz - vfloat(spheres.r2[id]);
+    vfloat delta= b * b - vload(traversal.a + i) * k;
+
+    vfloat zero= vfloat(0.f);
+    vfloat s= vsqrt(vmax(delta, zero));
+    vfloat inva= vload(traversal.inva + i);
+    vfloat t1= (-b - s) * inva;
+    vfloat t2= (-b + s) * inva;
+    t= vselect(t1 >= zero, t1, t2);
+
+    return vbits((delta >= zero) & (t >= zero) & (t < tmax));
+}
+
+// intersection des rayons du paquet avec un triangle, test de Moller-Trumbore, cf intersect_triangles_soa(). renvoie les bits des rayons qui le touchent avant tmax, les positions dans t et les coordonnees barycentriques dans u, v
+int intersect_triangle_lanes( const TriangleSoA& triangles, const int id, const RayPacket& packet, const int i, const vfloat tmax, vfloat& t, vfloat& u, vfloat& v )
+{
+    vfloat e1x= vfloat(triangles.e1x[id]), e1y= vfloat(triangles.e1y[id]), e1z= vfloat(triangles.e1z[id]);
+    vfloat e2x= vfloat(triangles.e2x[id]), e2y= vfloat(triangles.e2y[id]), e2z= vfloat(triangles.e2z[id]);
+    vfloat dx= vload(packet.dx + i), dy= vload(packet.dy + i), dz= vload(packet.dz + i);
+
+    vfloat px= dy * e2z - dz * e2y;
+    vfloat py= dz * e2x - dx * e2z;
+    vfloat pz= dx * e2y - dy * e2x;
+    vfloat det= e1x * px + e1y * py + e1z * pz;
+    vfloat inv= vfloat(1.f) / det;
+
+    vfloat sx= vload(packet.ox + i) - vfloat(triangles.ax[id]);
+    vfloat sy= vload(packet.oy + i) - vfloat(triangles.ay[id]);
+    vfloat sz= vload(packet.oz + i) - vfloat(triangles.az[id]);
+    u= (sx * px + sy * py + sz * pz) * inv;
+
+    vfloat qx= sy * e1z - sz * e1y;
+    vfloat qy= sz * e1x - sx * e1z;
+    vfloat qz= sx * e1y - sy * e1x;
+    v= (dx * qx + dy * qy + dz * qz) * inv;
+    t= (e2x * qx + e2y * qy + e2z * qz) * inv;
+
+    vfloat zero= vfloat(0.f);
+    return vbits(((det > zero) | (det < zero)) & (u >= zero) & (v >= zero) & (u + v <= vfloat(1.f)) & (t >= zero) & (t < tmax));
+}
+
+/* parcours d'un bvh par le paquet, avec une seule pile.
+    leaf(begin, end, groups) teste les objets [begin .. end[ (de SphereSoA ou TriangleSoA) avec les groupes de rayons qui touchent la feuille, et renvoie vrai pour arreter le parcours.
+ */
+template < typename Leaf >
+void traverse( const BVH& bvh, const RayPacket& packet, const PacketTraversal& traversal, const float *tmax, Leaf leaf )
+{
+    if(bvh.empty())
+        return;
+
+    int stack[64];
+    int top= 0;
+    stack[top++]= 0;
+    while(top > 0)
+    {
+        const BVHNode& node= bvh.nodes[stack[--top]];
+
+        // elimine le noeud pour tout le paquet, avec un seul test conservatif, puis teste les rayons
+        float packet_tmax= *std::max_element(tmax, tmax + PACKET_SIZE);
+        if(!traversal.may_intersect(node.bounds, packet_tmax))
+            continue;
+        unsigned long long groups= intersect_box(node.bounds, packet, traversal, tmax, node.leaf());
+        if(groups == 0)
+            continue;
+
+        if(node.leaf())
+        {
+            if(leaf(node.first, node.first + node.count, groups))
+                return;
+            continue;
+        }
+
+        // visite en premier le fils le plus proche, dans la direction moyenne du paquet
+        const BBox& left= bvh.nodes[node.first].bounds;
+        const BBox& right= bvh.nodes[node.first +1].bounds;
+        if(dot(traversal.mean, Vector(left.centroid(), right.centroid())) > 0)
+        {
+            stack[top++]= node.first +1;
+            stack[top++]= node.first;
+        }
+        else
+        {
+            stack[top++]= node.first;
+            stack[top++]= node.first +1;
+        }
+    }
+}
+
+}
+
+
+void intersect_packet( const Scene& scene, const RayPacket& packet, PacketHit& hits )
+{
+    PacketTraversal traversal(packet);
+
+    // raccourcit les rayons au fur et a mesure
+    alignas(32) float tmax[PACKET_SIZE];
+    for(int i= 0; i < PACKET_SIZE; i++)
+    {
+        tmax[i]= packet.tmax[i];
+        hits.t[i]= inf;
+        hits.objet[i]= RIEN;
+        hits.id[i]= -1;
+    }
+
+    // plans, en premier : raccourcissent les rayons avant le parcours des bvh. t= dot(n, a - o) / dot(n, d)
+    vfloat zero= vfloat(0.f);
+    for(int p= 0; p < int(scene.plans.size()); p++)
+    {
+        const Plan& plan= scene.plans[p];
+        vfloat nx= vfloat(plan.n.x), ny= vfloat(plan.n.y), nz= vfloat(plan.n.z);
+        for(int i= 0; i < PACKET_SIZE; i+= SIMD_WIDTH)
+        {
+            vfloat ax= vfloat(plan.a.x) - vload(packet.ox + i);
+            vfloat ay= vfloat(plan.a.y) - vload(packet.oy + i);
+            vfloat az= vfloat(plan.a.z) - vload(packet.oz + i);
+            vfloat t= (nx * ax + ny * ay + nz * az) / (nx * vload(packet.dx + i) + ny * vload(packet.dy + i) + nz * vload(packet.dz + i));
+
+            int bits= vbits((t > zero) & (t < vload(tmax + i)));
+            if(bits == 0)
+                continue;
+
+            alignas(32) float ts[SIMD_WIDTH];
+            vstore(ts, t);
+            for(int k= 0; k < SIMD_WIDTH; k++)
+            {
+                if(bits & (1 << k))
+                {
+                    tmax[i + k]= ts[k];
+                    hits.t[i + k]= ts[k];
+                    hits.objet[i + k]= PLAN;
+                    hits.id[i + k]= p;
+                }
+            }
+        }
+    }
+
+    const SphereSoA& spheres= scene.soa;
+    traverse(scene.bvh, packet, traversal, tmax,
+        [&]( const int begin, const int end, const unsigned long long groups )
+        {
+            for(int id= begin; id < end; id++)
+            for(int i= 0; i < PACKET_SIZE; i+= SIMD_WIDTH)
+            {
+                if((groups & (1ull << (i / SIMD_WIDTH))) == 0)
+                    continue;
+
+                vfloat t;
+                int bits= intersect_sphere_lanes(spheres, id, packet, traversal, i, vload(tmax + i), t);
+                if(bits == 0)
+                    continue;
+
+                alignas(32) float ts[SIMD_WIDTH];
+                vstore(ts, t);
+                for(int k= 0; k < SIMD_WIDTH; k++)
+                {
+                    if(bits & (1 << k))
+                    {
+                        tmax[i + k]= ts[k];
+                        hits.t[i + k]= ts[k];
+                        hits.objet[i + k]= SPHERE;
+                        hits.id[i + k]= spheres.ids[id];
+                    }
+                }
+            }
+            return false;
+        });
+
+    const TriangleSoA& triangles= scene.triangles;
+    traverse(scene.mesh_bvh, packet, traversal, tmax,
+        [&]( const int begin, const int end, const unsigned long long groups )
+        {
+            for(int id= begin; id < end; id++)
+            for(int i= 0; i < PACKET_SIZE; i+= SIMD_WIDTH)
+            {
+                if((groups & (1ull << (i / SIMD_WIDTH))) == 0)
+                    continue;
+
+                vfloat t, u, v;
+                int bits= intersect_triangle_lanes(triangles, id, packet, i, vload(tmax + i), t, u, v);
+                if(bits == 0)
+                    continue;
+
+                alignas(32) float ts[SIMD_WIDTH];
+                alignas(32) float us[SIMD_WIDTH];
+                alignas(32) float vs[SIMD_WIDTH];
+                vstore(ts, t);
+                vstore(us, u);
+                vstore(vs, v);
+                for(int k= 0; k < SIMD_WIDTH; k++)
+                {
+                    if(bits & (1 << k))
+                    {
+                        tmax[i + k]= ts[k];
+                        hits.t[i + k]= ts[k];
+                        hits.objet[i + k]= TRIANGLE;
+                        hits.id[i + k]= triangles.ids[id];
+                        hits.u[i + k]= us[k];
+                        hits.v[i + k]= vs[k];
+                    }
+                }
+            }
+            return false;
+        });
+}
+
+void occluded_packet( const Scene& scene, const RayPacket& packet, bool occluded[PACKET_SIZE] )
+{
+    PacketTraversal traversal(packet);
+
+    // les rayons deja bloques sont desactives
+    alignas(32) float tmax[PACKET_SIZE];
+    int remaining= 0;
+    for(int i= 0; i < PACKET_SIZE; i++)
+    {
+        tmax[i]= packet.tmax[i];
+        occluded[i]= false;
+        if(tmax[i] < 0)
+            continue;
+
+        // les plans, comme occluded()
+        for(const Plan& plan : scene.plans)
+        {
+            float t= dot(plan.n, Vector(packet.origin(i), plan.a)) / dot(plan.n, packet.direction(i));
+            if(t > 0 && t < tmax[i])
+            {
+                occluded[i]= true;
+                tmax[i]= -1;
+                break;
+            }
+        }
+        if(!occluded[i])
+            remaining++;
+    }
+    if(remaining == 0)
+        return;
+
+    const SphereSoA& spheres= scene.soa;
+    traverse(scene.bvh, packet, traversal, tmax,
+        [&]( const int begin, const int end, const unsigned long long groups )
+        {
+            for(int id= begin; id < end; id++)
+            for(int i= 0; i < PACKET_SIZE; i+= SIMD_WIDTH)
+            {
+                if((groups & (1ull << (i / SIMD_WIDTH))) == 0)
+                    continue;
+
+                vfloat t;
+                int bits= intersect_sphere_lanes(spheres, id, packet, traversal, i, vload(tmax + i), t);
+                for(int k= 0; k < SIMD_WIDTH; k++)
+                {
+                    if(bits & (1 << k))
+                    {
+                        occluded[i + k]= true;
+                        tmax[i + k]= -1;
+                        remaining--;
+                    }
+                }
+            }
+
+            // tous les rayons sont bloques, inutile de continuer
+            return remaining == 0;
+        });
+    if(remaining == 0)
+        return;
+
+    const TriangleSoA& triangles= scene.triangles;
+    traverse(scene.mesh_bvh, packet, traversal, tmax,
+        [&]( const int begin, const int end, const unsigned long long groups )
+        {
+            for(int id= begin; id < end; id++)
+            for(int i= 0; i < PACKET_SIZE; i+= SIMD_WIDTH)
+            {
+                if((groups & (1ull << (i / SIMD_WIDTH))) == 0)
+                    continue;
+
+                vfloat t, u, v;
+                int bits= intersect_triangle_lanes(triangles, id, packet, i, vload(tmax + i), t, u, v);
+                for(int k= 0; k < SIMD_WIDTH; k++)
+                {
+                    if(bits & (1 << k))
+                    {
+                        occluded[i + k]= true;
+                        tmax[i + k]= -1;
+                        remaining--;
+                    }
+                }
+            }
+
+            return remaining == 0;
+        });
+}
+
+Hit packet_hit( const Scene& scene, const RayPacket& packet, const PacketHit& hits, const int i )
+{
+    float t= hits.t[i];
+    if(t == inf)
+        return Hit();
+
+    Point o= packet.origin(i);
+    Vector d= packet.direction(i);
+    Point p= o + t * d;
+    if(hits.objet[i] == PLAN)
+    {
+        const Plan& plan= scene.plans[hits.id[i]];
+        return Hit(t, p, plan.n, plan.col, PLAN, hits.id[i]);
+    }
+    if(hits.objet[i] == TRIANGLE)
+        return triangle_hit(scene, hits.id[i], o, d, t, hits.u[i], hits.v[i]);
+
+    const Sphere& sphere= scene.spheres[hits.id[i]];
+    return Hit(t, p, Vector(sphere.c, p), sphere.col, SPHERE, hits.id[i]);
+}
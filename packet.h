@@ -0,0 +1,69 @@
+
+#ifndef _PACKET_H
+#define _PACKET_H
+
+#include "vec.h"
+#include "scene.h"
+
+
+//! \file
+//! paquets de rayons coherents, traces ensemble dans la scene.
+
+//! les paquets couvrent des blocs de PACKET_WIDTH x PACKET_WIDTH pixels.
+const int PACKET_WIDTH= 8;
+//! nombre de rayons d'un paquet.
+const int PACKET_SIZE= PACKET_WIDTH * PACKET_WIDTH;
+
+/*! paquet de rayons o + t*d, stockes par composantes, pour calculer les intersections de SIMD_WIDTH rayons a la fois, cf simd.h.
+    un rayon est inactif si tmax est negatif, il ne touche aucun objet, par exemple pour les pixels en dehors de l'image.
+*/
+struct RayPacket
+{
+    alignas(32) float ox[PACKET_SIZE];
+    alignas(32) float oy[PACKET_SIZE];
+    alignas(32) float oz[PACKET_SIZE];
+    alignas(32) float dx[PACKET_SIZE];
+    alignas(32) float dy[PACKET_SIZE];
+    alignas(32) float dz[PACKET_SIZE];
+    alignas(32) float tmax[PACKET_SIZE];
+
+    //! initialise le ieme rayon du paquet.
+    void set( const int i, const Point& o, const Vector& d, const float t= inf )
+    {
+        ox[i]= o.x; oy[i]= o.y; oz[i]= o.z;
+        dx[i]= d.x; dy[i]= d.y; dz[i]= d.z;
+        tmax[i]= t;
+    }
+
+    //! desactive le ieme rayon du paquet.
+    void disable( const int i ) { set(i, Point(), Vector(0, 0, 1), -1); }
+
+    //! renvoie l'origine du ieme rayon.
+    Point origin( const int i ) const { return Point(ox[i], oy[i], oz[i]); }
+    //! renvoie la direction du ieme rayon.
+    Vector direction( const int i ) const { return Vector(dx[i], dy[i], dz[i]); }
+};
+
+//! intersections des rayons d'un paquet.
+struct PacketHit
+{
+    alignas(32) float t[PACKET_SIZE];       //!< position de l'intersection la plus proche sur chaque rayon, ou inf.
+    Objet objet[PACKET_SIZE];               //!< type de l'objet touche, ou RIEN.
+    int id[PACKET_SIZE];                    //!< indice de l'objet touche, dans Scene::spheres, Scene::plans ou les triangles de Scene::mesh, ou -1.
+    float u[PACKET_SIZE];                   //!< coordonnees barycentriques, pour les triangles.
+    float v[PACKET_SIZE];
+};
+
+//! renvoie l'intersection du ieme rayon du paquet, dans le meme format que intersect().
+Hit packet_hit( const Scene& scene, const RayPacket& packet, const PacketHit& hits, const int i );
+
+/*! intersections les plus proches des rayons du paquet avec les plans, les spheres et les triangles de la scene, cf intersect().
+    les plans sont testes en premier et raccourcissent les rayons. le paquet parcourt ensuite les bvh avec une seule pile : un noeud est elimine pour tous les rayons si l'englobant du paquet (arithmetique d'intervalles)
+    ne touche pas sa boite, sinon les rayons sont testes par groupes de SIMD_WIDTH.
+*/
+void intersect_packet( const Scene& scene, const RayPacket& packet, PacketHit& hits );
+
+//! pour chaque rayon actif du paquet, occluded[i] est vrai si un objet de la scene coupe le rayon avant tmax, cf occluded().
+void occluded_packet( const Scene& scene, const RayPacket& packet, bool occluded[PACKET_SIZE] );
+
+#endif
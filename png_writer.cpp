@@ -0,0 +1,224 @@
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <vector>
+
+#include "png_writer.h"
+#include "deflate.h"
+
+
+namespace {
+
+// taille des blocs de donnees filtrees compresses par un thread, le decoupage ne depend pas du nombre de threads
+const int DEFLATE_BLOCK= 256 * 1024;
+
+
+// crc32 des chunks png
+struct CRCTable
+{
+    uint32_t table[256];
+
+    CRCTable( )
+    {
+        for(uint32_t i= 0; i < 256; i++)
+        {
+            uint32_t c= i;
+            for(int k= 0; k < 8; k++)
+                c= (c & 1) ? 0xedb88320u ^ (c >> 1) : (c >> 1);
+            table[i]= c;
+        }
+    }
+};
+
+uint32_t crc32( uint32_t crc, const unsigned char *data, const size_t n )
+{
+    static const CRCTable crc_table;
+
+    crc= ~crc;
+    for(size_t i= 0; i < n; i++)
+        crc= crc_table.table[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+    return ~crc;
+}
+
+inline unsigned char paeth( const int a, const int b, const int c )
+{
+    int p= a + b - c;
+    int pa= std::abs(p - a);
+    int pb= std::abs(p - b);
+    int pc= std::abs(p - c);
+    if(pa <= pb && pa <= pc) return (unsigned char) a;
+    if(pb <= pc) return (unsigned char) b;
+    return (unsigned char) c;
+}
+
+// filtre une ligne, type : 0 aucun, 1 sub, 2 up, 3 average, 4 paeth. prev est nul pour la premiere ligne.
+void filter_row( const int type, const unsigned char *row, const unsigned char *prev, const int n, unsigned char *out )
+{
+    const int bpp= 4;
+    for(int i= 0; i < n; i++)
+    {
+        int a= (i >= bpp) ? row[i - bpp] : 0;
+        int b= prev ? prev[i] : 0;
+        int c= (prev && i >= bpp) ? prev[i - bpp] : 0;
+
+        int predictor= 0;
+        switch(type)
+        {
+            case 1: predictor= a; break;
+            case 2: predictor= b; break;
+            case 3: predictor= (a + b) >> 1; break;
+            case 4: predictor= paeth(a, b, c); break;
+        }
+        out[i]= (unsigned char) (row[i] - predictor);
+    }
+}
+
+// choisit le filtre qui produit les plus petites differences, cf recommandations png
+void filter_row( const unsigned char *row, const unsigned char *prev, const int n, unsigned char *out, const PNGCompression compression )
+{
+    if(compression == PNG_FAST)
+    {
+        out[0]= 4;
+        filter_row(4, row, prev, n, out + 1);
+        return;
+    }
+
+    std::vector<unsigned char> tmp(n);
+    int best= -1;
+    long best_cost= 0;
+    for(int type= 0; type < 5; type++)
+    {
+        filter_row(type, row, prev, n, tmp.data());
+
+        long cost= 0;
+        for(int i= 0; i < n; i++)
+            cost+= std::abs(int((signed char) tmp[i]));
+
+        if(best < 0 || cost < best_cost)
+        {
+            best= type;
+            best_cost= cost;
+            out[0]= (unsigned char) type;
+            std::memcpy(out + 1, tmp.data(), n);
+        }
+    }
+}
+
+
+void write_u32( std::vector<unsigned char>& out, const uint32_t v )
+{
+    out.push_back(uint8_t(v >> 24));
+    out.push_back(uint8_t(v >> 16));
+    out.push_back(uint8_t(v >> 8));
+    out.push_back(uint8_t(v));
+}
+
+// chunk png : taille, type, donnees, crc du type et des donnees
+bool write_chunk( FILE *out, const char type[4], const std::vector<unsigned char>& data )
+{
+    std::vector<unsigned char> header;
+    write_u32(header, uint32_t(data.size()));
+    header.insert(header.end(), type, type + 4);
+
+    uint32_t crc= crc32(0, header.data() + 4, 4);
+    crc= crc32(crc, data.data(), data.size());
+    std::vector<unsigned char> footer;
+    write_u32(footer, crc);
+
+    return fwrite(header.data(), 1, header.size(), out) == header.size()
+        && (data.empty() || fwrite(data.data(), 1, data.size(), out) == data.size())
+        && fwrite(footer.data(), 1, footer.size(), out) == footer.size();
+}
+
+}
+
+
+bool write_png( const unsigned char *pixels, const int width, const int height, const char *filename, const bool flipY, const PNGCompression compression )
+{
+    if(width <= 0 || height <= 0)
+        return false;
+
+    // filtre les lignes, en parallele. chaque ligne est precedee par le type de son filtre
+    const int row_size= 4 * width;
+    const int line_size= row_size + 1;
+    std::vector<unsigned char> filtered(size_t(line_size) * height);
+    #pragma omp parallel for schedule(dynamic, 16)
+    for(int y= 0; y < height; y++)
+    {
+        int source= flipY ? height -1 - y : y;
+        int previous= flipY ? source + 1 : source - 1;
+        const unsigned char *row= pixels + size_t(row_size) * source;
+        const unsigned char *prev= (y > 0) ? pixels + size_t(row_size) * previous : nullptr;
+        filter_row(row, prev, row_size, filtered.data() + size_t(line_size) * y, compression);
+    }
+
+    // compresse les blocs, en parallele
+    if(filtered.size() > size_t(0x7fffffff))
+    {
+        printf("[error] writing png '%s': image too large...\n", filename);
+        return false;
+    }
+
+    const int size= int(filtered.size());
+    const int n= (size + DEFLATE_BLOCK -1) / DEFLATE_BLOCK;
+    const int max_chain= (compression == PNG_FAST) ? DEFLATE_FAST : DEFLATE_DEFAULT;
+    std::vector< std::vector<unsigned char> > blocks(n);
+    std::vector<uint32_t> adlers(n);
+    #pragma omp parallel for schedule(dynamic, 1)
+    for(int i= 0; i < n; i++)
+    {
+        int begin= i * DEFLATE_BLOCK;
+        int end= std::min(size, begin + DEFLATE_BLOCK);
+        blocks[i]= deflate_block(filtered.data(), begin, end, i == n -1, max_chain);
+        adlers[i]= adler32(filtered.data() + begin, end - begin);
+    }
+
+    uint32_t adler= adlers[0];
+    for(int i= 1; i < n; i++)
+    {
+        int begin= i * DEFLATE_BLOCK;
+        int end= std::min(size, begin + DEFLATE_BLOCK);
+        adler= adler32_combine(adler, adlers[i], end - begin);
+    }
+
+    // entete zlib dans le premier chunk IDAT, adler32 dans le dernier, 1 chunk par bloc compresse
+    const unsigned char zlib_header[2]= { 0x78, 0x01 };
+    blocks[0].insert(blocks[0].begin(), zlib_header, zlib_header + 2);
+    write_u32(blocks[n -1], adler);
+
+    FILE *out= fopen(filename, "wb");
+    if(!out)
+    {
+        printf("[error] writing png '%s'...\n", filename);
+        return false;
+    }
+
+    const unsigned char signature[8]= { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+    bool code= fwrite(signature, 1, 8, out) == 8;
+
+    std::vector<unsigned char> header;
+    write_u32(header, uint32_t(width));
+    write_u32(header, uint32_t(height));
+    header.push_back(8);        // 8 bits par composante
+    header.push_back(6);        // rgba
+    header.push_back(0);        // deflate
+    header.push_back(0);        // filtres adaptatifs
+    header.push_back(0);        // pas d'entrelacement
+    code= code && write_chunk(out, "IHDR", header);
+
+    for(int i= 0; i < n && code; i++)
+        code= write_chunk(out, "IDAT", blocks[i]);
+
+    code= code && write_chunk(out, "IEND", std::vector<unsigned char>());
+
+    if(fclose(out) != 0 || !code)
+    {
+        printf("[error] writing png '%s'...\n", filename);
+        return false;
+    }
+
+    return true;
+}
@@ -0,0 +1,27 @@
+
+#ifndef _PNG_WRITER_H
+#define _PNG_WRITER_H
+
+
+//! \addtogroup image
+///@{
+
+//! \file
+//! ecriture parallele d'images .png : les lignes sont filtrees, puis compressees par blocs independants, sur plusieurs threads.
+
+//! compression des images .png : rapide, pour les apercus, ou plus compacte, par defaut.
+enum PNGCompression
+{
+    PNG_FAST,
+    PNG_DEFAULT
+};
+
+/*! enregistre une image 8 bits rgba, width x height pixels, au format .png.
+    les lignes sont filtrees en parallele, puis les donnees sont decoupees en blocs compresses (deflate) en parallele.
+    chaque bloc peut referencer les 32Ko qui le precedent, comme un compresseur sequentiel, et les blocs sont termines par un bloc vide aligne sur un octet,
+    pour les concatener dans un seul flux zlib valide. le decoupage ne depend pas du nombre de threads, le fichier non plus.
+*/
+bool write_png( const unsigned char *pixels, const int width, const int height, const char *filename, const bool flipY= true, const PNGCompression compression= PNG_DEFAULT );
+
+///@}
+#endif
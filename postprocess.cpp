@@ -0,0 +1,88 @@
+
+#include <cmath>
+#include <algorithm>
+
+#include "postprocess.h"
+#include "image_io.h"
+#include "fast_math.h"
+
+
+namespace {
+
+// meme conversion que write_image_png()
+inline unsigned char quantize( const float x )
+{
+    float v= x * 255;
+    if(v < 0) return 0;
+    else if(v > 255) return 255;
+    else return (unsigned char) v;
+}
+
+}
+
+
+bool write_images_preview( const Image& image, const std::vector<PreviewOutput>& outputs, const bool flipY, const float gamma )
+{
+    if(image.size() == 0)
+        return false;
+
+    const int n= int(outputs.size());
+    const int size= int(image.size());
+
+    // etape 1 : luminance min / max de chaque version, puis histogramme et exposition, cf range()
+    auto bloom= [&]( const Color& pixel, const int k ) { return outputs[k].bloom(pixel); };
+    std::vector<Histogram> h(n);
+    histograms(image, h, bloom);
+
+    for(int k= 0; k < n; k++)
+        h[k]= Histogram(h[k].imin, h[k].imax);
+    histograms(image, h, bloom);
+
+    std::vector<float> scale(n);
+    for(int k= 0; k < n; k++)
+    {
+        float saturation= h[k].gmax;
+        h[k].percentile(image.size(), .75f, saturation);
+        scale[k]= 1 / std::pow(saturation, 1 / gamma);
+    }
+
+    // etape 2 : bloom, exposition, gamma et conversion 8 bits de toutes les versions, par blocs de pixels, cf tone() et write_image_png()
+    const int block= 1024;
+    std::vector< std::vector<unsigned char> > pixels(n, std::vector<unsigned char>(size * 4));
+    float invg= 1 / gamma;
+    #pragma omp parallel for schedule(static)
+    for(int i= 0; i < size; i+= block)
+    {
+        const int m= std::min(block, size - i);
+        Color colors[block];
+        for(int k= 0; k < n; k++)
+        {
+            for(int j= 0; j < m; j++)
+                colors[j]= outputs[k].bloom(image(size_t(i + j)));
+
+            // transformation gamma rgb -> srgb, cf vpow()
+            pow_colors(colors, m, invg, scale[k]);
+
+            unsigned char *p= pixels[k].data() + 4*size_t(i);
+            for(int j= 0; j < m; j++, p+= 4)
+            {
+                Color color= colors[j];
+                if(std::isnan(color.r) || std::isnan(color.g) || std::isnan(color.b))
+                    // marque les pixels pourris avec une couleur improbable...
+                    color= Color(1, 0, 1);
+
+                p[0]= quantize(color.r);
+                p[1]= quantize(color.g);
+                p[2]= quantize(color.b);
+                p[3]= 255;
+            }
+        }
+    }
+
+    bool code= true;
+    for(int k= 0; k < n; k++)
+        if(!write_image_png(pixels[k].data(), image.width(), image.height(), outputs[k].filename, flipY, PNG_FAST))
+            code= false;
+
+    return code;
+}
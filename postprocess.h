@@ -0,0 +1,62 @@
+
+#ifndef _POSTPROCESS_H
+#define _POSTPROCESS_H
+
+#include <vector>
+
+#include "color.h"
+#include "image.h"
+
+
+//! \addtogroup image
+///@{
+
+//! \file
+//! post-traitement : exposition, bloom, transformation gamma et conversion 8 bits de plusieurs images, en un seul parcours de l'image calculee.
+
+/*! bloom : eclaircit les pixels dont la luminance moyenne depasse threshold, en leur ajoutant color, proportionnellement a l'ecart au seuil et a intensity.
+    Bloom() ne modifie pas les pixels.
+*/
+struct Bloom
+{
+    Color color;
+    float threshold;
+    float intensity;
+
+    Bloom( ) : color(Black()), threshold(1), intensity(0) {}
+    Bloom( const Color& _color, const float _threshold, const float _intensity ) : color(_color), threshold(_threshold), intensity(_intensity) {}
+
+    //! renvoie la couleur du pixel apres le bloom.
+    Color operator() ( const Color& pixel ) const
+    {
+        if(intensity == 0)
+            return pixel;
+
+        float luminance= (pixel.r + pixel.g + pixel.b) / 3.0f;
+        if(luminance > threshold)
+        {
+            float k= (luminance - threshold) / (1.0f - threshold);
+            return pixel + color * k * intensity;
+        }
+
+        return pixel;
+    }
+};
+
+//! image a produire : fichier .png et bloom applique avant l'exposition.
+struct PreviewOutput
+{
+    const char *filename;
+    Bloom bloom;
+
+    PreviewOutput( const char *_filename, const Bloom& _bloom= Bloom() ) : filename(_filename), bloom(_bloom) {}
+};
+
+/*! enregistre plusieurs versions d'une image, au format .png, comme write_image_preview(), avec un bloom different pour chaque version.
+    l'exposition de chaque version est evaluee sur l'image apres son bloom, comme range(). les pixels sont transformes et convertis en 8 bits pour toutes les versions
+    en parallele, dans le meme parcours de l'image, sans construire d'image intermediaire.
+*/
+bool write_images_preview( const Image& image, const std::vector<PreviewOutput>& outputs, const bool flipY= true, const float gamma= float(2.2) );
+
+///@}
+#endif
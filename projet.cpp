@@ -2,162 +2,24 @@
 #include "color.h"
 #include "image.h"
 #include "image_io.h"
+#include "render.h"
+#include "scene.h"
+#include "packet.h"
+#include "camera.h"
+#include "accumulation.h"
+#include "scene_io.h"
+#include "postprocess.h"
 #include <limits>
 #include <math.h>
 #include <iostream>
 #include <algorithm>
+#include <string>
+#include <cstdio>
+#include <cstdlib>
 
 
 using namespace std;
 
-const float inf= std::numeric_limits<float>::infinity();
-
-struct Sphere
-{
-    Point c; //centre
-    int r; //rayon
-    Color col; //couleur
-};
-
-struct Plan
-{
-    Point a; //point
-    Vector n; //normal passant par a
-    Color col; //couleur plan
-};
-
-struct Lumiere
-{
-    Vector dirL;
-    Color col;
-};
-
-struct Hit
-{
-    float t;        // position sur le rayon, ou inf s'il n'y a pas d'intersection
-    Point p;        // position du point, s'il existe
-    Vector n;       // normale du point d'intersection, s'il existe
-    Color color;    // couleur du point d'intersection, s'il existe
-
-    Hit( ) : t(inf), p(), n(), color() {}     // pas d'intersection
-    Hit(const float &x, const Point &point, const Vector &norm, const Color &c)
-    {
-        t=x; p=point; n=norm; color=c;
-    }
-};
-
-struct Scene
-{
-    std::vector<Sphere> spheres;
-    Plan plan;
-    std::vector<Lumiere> lums;
-};
-
-float intersect_sphere (const Point &c, const float &r, const Point &o, const Vector &d)
-{
-    float a = dot(d,d);
-    float b = 2*dot(d, Vector(c,o));
-    float k = dot(Vector(c,o), Vector(c,o))- r*r;
-    float delta = b*b-4*a*k;
-
-    if(delta>=0)
-    {
-        float t1 = (-b - sqrt(b*b-4*a*k))/(2*a);
-        float t2 = (-b + sqrt(b*b-4*a*k))/(2*a);
-
-        if(t1<0&&t2>=0)
-            return t2;
-        if(t2<0&&t1>=0)
-            return t1;
-        if(t1<0&&t2<0)
-            return inf;
-        if(t1>=0&&t2>=0)
-        {
-            if(t1<t2)
-                return t1;
-            return t2;
-        }
-    }
-    return inf;
-}
-
-Hit intersect_sphere_hit(const Sphere s, const Point &o, const Vector &d)
-{
-    float t = intersect_sphere(s.c, s.r, o, d);
-    if(t<0) return {};
-    return Hit(t,o, Vector(o+ t*d),s.col);
-}
-
-Hit intersect_spheres_hit(const Scene &scene, const Point &o, const Vector &d)
-{
-    Hit plus_proche;
-    Hit inter;
-    plus_proche.t= inf;
-
-    for(const auto& sphere : scene.spheres)
-    {
-        inter = intersect_sphere_hit(sphere,o,d);
-        if(inter.t<plus_proche.t)
-        {
-            plus_proche = inter;
-        }
-    }
-    return plus_proche;
-}
-
-float intersect_spheres(const std::vector<Sphere>& spheres, const Point &o, const Vector &d)
-{
-    float tmin = intersect_sphere(spheres[0].c,spheres[0].r, o, d);;
-    float aux;
-
-    for(int i=1; i< spheres.size(); i++)
-    {
-        aux = intersect_sphere(spheres[i].c, spheres[i].r, o, d);
-        if (aux<tmin)
-        {
-            tmin = aux;
-        }
-    }
-    return tmin;
-}
-
-Hit intersect_plan(const Plan &p, const Point& o, const Vector& d)
-{
-    float t = dot(p.n,Vector(o,p.a))/dot(p.n,d);
-    if (t<0) return {};
-    return Hit(t, o, p.n, p.col);
-}
-
-Hit intersect_plan_hit(const Scene& scene, const Point& o, const Vector& d )
-{
-    Hit plus_proche;
-    plus_proche.t = inf;
-    Hit h= intersect_plan(scene.plan, o, d);//, plus_proche.t);
-    if(h.t<plus_proche.t && h.t>0)
-        plus_proche= h;
-
-    return plus_proche;
-}
-
-
-//fonction du cours modifi
-Hit intersect(const Scene& scene, const Point& o, const Vector& d )
-{
-    Hit plus_proche;
-    Hit h;
-    plus_proche.t= 0;
-    float t =0;
-    for(const auto &sphere : scene.spheres)
-    {
-        t = intersect_sphere(sphere.c, sphere.r, o, d);
-        std::cout<<"c "<<sphere.c<<endl;
-        std::cout<<"r "<<sphere.r<<endl;
-        std::cout<<"t "<<t<<endl;
-    }
-
-    return plus_proche;
-}
-
 Color soleil(const Scene& scene, const Color &colP, const Vector &n) // direction lum, coul lum, coul p, norm p
 {
     Color sol = Black();
@@ -193,13 +55,7 @@ Color calculer_ombre_reflechie(const Scene& scene, const Hit& h)
             Vector l = lumiere.dirL;
             theta = std::max(float(0), dot(h.n, l));
 
-            bool est_dans_ombre = false;
-            for (const auto& sphere : scene.spheres) {
-                if (intersect_sphere(sphere.c, sphere.r, o, l) != inf) {
-                    est_dans_ombre = true;
-                    break;
-                }
-            }
+            bool est_dans_ombre = occluded(scene, Ray(o, l));
             if (!est_dans_ombre)// si c est dan l ombre
             {
                 c = c + h.color * lumiere.col * theta;
@@ -210,29 +66,6 @@ Color calculer_ombre_reflechie(const Scene& scene, const Hit& h)
     return Black();
 }
 
-// methode pour appliquer un effet de bloom  une image avec un filtre, apres la double boucle du main
-void filtre_image(Image& image, const Color& colore, float nivBloom, float intensite)
-{
-    for (int y = 0; y < image.height(); y++)
-    {
-        for (int x = 0; x < image.width(); x++)
-        {
-            Color pix = image(x, y);
-            float rapport_lum = (pix.r + pix.g + pix.b) / 3.0f;
-
-            if (rapport_lum>nivBloom)
-            {
-                float norm_rapport = (rapport_lum - nivBloom) / (1.0f - nivBloom);
-                Color col_effet = colore * norm_rapport * intensite;
-                image(x, y) = pix + col_effet;
-            }
-            else {
-                image(x, y) = pix;
-            }
-        }
-    }
-}
-
 //fonction pour calculer le vector reflexion, extraite du cours
 Vector reflection(const Vector& incident, const Vector& normal)
 {
@@ -293,123 +126,242 @@ Color couleurCielDeuxLum(const Lumiere& lumiereBasse, const Lumiere& lumiereHaut
 }
 
 
-//scene avec ombre reflechie
-int main( )
+// couleur de l'objet touche par un rayon, ou du ciel, sans les ombres portees sur le plan, cf calculer_ombre_reflechie()
+Color couleur_directe(const Scene& scene, const Ray& ray, const Hit& h)
 {
-    Image imageJour(1024, 512);
-
-    float ratioWH = (float)(imageJour.width())/(float)(imageJour.height());
-
-    Sphere s1;
-    s1.c = Point(-1,0,-3);
-    s1.r = 1;
-    s1.col=Red();
-
-    Sphere s2;
-    s2.c = Point(1,0,-3);
-    s2.r = 1;
-    s2.col=Blue()+Color(0,0.3,0) + Color(0.7,0,0);
-
-    Sphere s3;
-    s3.c = Point(-3,0,-3);
-    s3.r = 1;
-    s3.col=Yellow();
-
-    Sphere s4;
-    s4.c = Point(0,0,-2);
-    s4.r = 1;
-    s4.col=Yellow()+Color(0.2,0,0.5);
-
-    Plan p;
-    p.a = Point(0,-1, 0);
-    p.n = Vector(0, 1, 0);
-    p.col = Green()-Color(0,0.3,0) + Color(0.1,0,0.1);
-
-    Lumiere lum1;
-    lum1.dirL = Vector(1,0.5,0);
-    lum1.col = Color(0.7,0.1,0.3);//Blue()- Color(0,0,0.2);//Red()+ Color(0,0,0.5)-Color(0.2,0,0);
-
-    Lumiere lum2;
-    lum2.dirL = Vector(-1,0.5,0);
-    lum2.col = Color(0.2,0.1,0.5);//Blue()- Color(0,0,0.1);
+    if(h.objet == RIEN)
+    {
+        // le ciel est colore par les 2 premieres lumieres
+        if(scene.lums.size() < 2)
+            return scene.lums.empty() ? Black() : scene.lums[0].col;
+        return couleurCielInterpole(ray.d, scene.lums[0], scene.lums[1]);
+    }
 
-    Scene scene;
+    return soleil_hit(scene, h);
+}
 
-    scene.spheres.push_back(s1);
-    scene.spheres.push_back(s2);
-    scene.spheres.push_back(s3);
-    scene.spheres.push_back(s4);
+// couleur du point (px, py) de l'image, calculee independamment des autres pixels
+Color couleur_pixel(const Scene& scene, const Camera& camera, const float px, const float py)
+{
+    Ray ray = camera.ray(px, py);
 
+    Hit h = intersect(scene, ray);
+    Color couleur = couleur_directe(scene, ray, h);
+    if(h.objet == PLAN)
+        couleur = couleur + calculer_ombre_reflechie(scene, h);
 
-    scene.plan=p;
-    scene.lums.push_back(lum1);
-    scene.lums.push_back(lum2);
+    return couleur;
+}
 
 
+// rendu par paquets de PACKET_WIDTH x PACKET_WIDTH rayons primaires, cf packet.h
+// les intersections et les rayons d'ombre vers les lumieres sont calcules par paquets, puis la couleur de chaque pixel.
+void rendu_paquets(Image& image, const Scene& scene, const Camera& camera)
+{
+    for_each_tile(image, [&](const Tile& tile)
+    {
+        for(int y = tile.y0; y < tile.y1; y+= PACKET_WIDTH)
+        for(int x = tile.x0; x < tile.x1; x+= PACKET_WIDTH)
+        {
+            RayPacket primaires;
+            for(int j = 0; j < PACKET_WIDTH; j++)
+            {
+                // une ligne du paquet : les directions des pixels voisins ne different que de camera.dx
+                Vector d = camera.direction(x, y + j);
+                for(int k = 0; k < PACKET_WIDTH; k++, d = d + camera.dx)
+                {
+                    int i = j * PACKET_WIDTH + k;
+                    if(x + k >= tile.x1 || y + j >= tile.y1)
+                        primaires.disable(i);     // bloc incomplet, au bord de l'image
+                    else
+                        primaires.set(i, camera.o, d);
+                }
+            }
 
-    Point o= Point(0, 0, 0);
+            PacketHit hits;
+            intersect_packet(scene, primaires, hits);
 
-    for(int py = 0; py < imageJour.height(); py++) {
-    for(int px = 0; px < imageJour.width(); px++) {
-        Point o = Point(0, 0, 0);    // origine
-        Point e = Point(((float)px) / ((float)imageJour.width()) * 2 - 1,
-                        ((float)py) / ((float)imageJour.height()) * 2 - 1,
-                        -1); // extremite
+            Hit h[PACKET_SIZE];
+            Color couleurs[PACKET_SIZE];
+            for(int i = 0; i < PACKET_SIZE; i++)
+            {
+                h[i] = packet_hit(scene, primaires, hits, i);
+                couleurs[i] = couleur_directe(scene, Ray(primaires.origin(i), primaires.direction(i)), h[i]);
+            }
 
+            // ombres sur le plan, cf calculer_ombre_reflechie() : les rayons vers une lumiere ont tous la meme direction
+            float e = 0.001;
+            for(const auto& lumiere : scene.lums)
+            {
+                RayPacket ombres;
+                for(int i = 0; i < PACKET_SIZE; i++)
+                {
+                    if(h[i].objet == PLAN)
+                        ombres.set(i, h[i].p + e * h[i].n, lumiere.dirL);
+                    else
+                        ombres.disable(i);
+                }
 
-        e.x = e.x * ratioWH;
-        Vector d = Vector(o, e);     // direction : extremite - origine
+                bool est_dans_ombre[PACKET_SIZE];
+                occluded_packet(scene, ombres, est_dans_ombre);
 
-        Hit interScene = intersect_plan_hit(scene , o, d); //intersect(scene, o, d);
-        interScene.p = o + interScene.t*d;
-        Color couleur_finale = soleil(scene, interScene.color, interScene.n)+ calculer_ombre_reflechie(scene, interScene);//+effettoLucido(interScene,White(),1);//+effetNuitScene(scene, interScene,0.05,1);//+ calculer_reflexion(scene, interScene, 2);
+                for(int i = 0; i < PACKET_SIZE; i++)
+                {
+                    if(ombres.tmax[i] >= 0 && !est_dans_ombre[i])
+                    {
+                        float theta = std::max(float(0), dot(h[i].n, lumiere.dirL));
+                        couleurs[i] = couleurs[i] + h[i].color * lumiere.col * theta;
+                    }
+                }
+            }
 
-        if(interScene.t!=inf)
-        {
-            imageJour(px,py) =couleur_finale;
+            for(int i = 0; i < PACKET_SIZE; i++)
+                if(primaires.tmax[i] >= 0)
+                    image(x + i % PACKET_WIDTH, y + i / PACKET_WIDTH) = couleurs[i];
         }
+    });
+}
 
-        float t1 = intersect_sphere(scene.spheres[0].c,scene.spheres[0].r,o,d);
-        float t2 = intersect_sphere(scene.spheres[1].c,scene.spheres[1].r,o,d);
-        float t3 = intersect_sphere(scene.spheres[2].c,scene.spheres[2].r,o,d);
 
-        if(t1!=inf && t1<interScene.t && t1<t2)
-        {
-            Point interSphere = o + t1*d;
-            imageJour(px, py) = soleil(scene,  scene.spheres[0].col, Vector(scene.spheres[0].c, interSphere));
-        }
+//scene avec ombre reflechie
+// projet [--paquets] : rendu pixel par pixel, ou par paquets de rayons
+// projet --echantillons n [--seuil s] : rendu progressif, n rayons par pixel, moins si le pixel converge avant
+// projet --scene fichier [--export fichier.bin] : charge la scene et la camera, cf scene_io.h, et les enregistre au format binaire
+int main(int argc, char **argv)
+{
+    // projet [--paquets] [--echantillons n [--seuil s]] [--scene fichier] [--export fichier.bin] [objet.obj]
+    bool paquets = false;
+    int echantillons = 0;
+    float seuil = 0;
+    const char *fichier_scene = nullptr;
+    const char *fichier_export = nullptr;
+    const char *objet = nullptr;
+    for(int i = 1; i < argc; i++)
+    {
+        std::string option = argv[i];
+        if(option == "--paquets")
+            paquets = true;
+        else if(option == "--echantillons" && i + 1 < argc)
+            echantillons = atoi(argv[++i]);
+        else if(option == "--seuil" && i + 1 < argc)
+            seuil = atof(argv[++i]);
+        else if(option == "--scene" && i + 1 < argc)
+            fichier_scene = argv[++i];
+        else if(option == "--export" && i + 1 < argc)
+            fichier_export = argv[++i];
+        else
+            objet = argv[i];
+    }
 
-        if(t2!=inf&&t2<interScene.t&&t2<t1)
-        {
-            Point interSphere = o + t2*d;
-            imageJour(px, py) = soleil(scene, scene.spheres[1].col, Vector(scene.spheres[1].c, interSphere));
+    Image imageJour(1024, 512);
 
-        }
+    Scene scene;
+    View vue;
+    if(fichier_scene)
+    {
+        if(!read_scene(fichier_scene, scene, vue))
+            return 1;
+    }
+    else
+    {
+        Sphere s1;
+        s1.c = Point(-1,0,-3);
+        s1.r = 1;
+        s1.col=Red();
+
+        Sphere s2;
+        s2.c = Point(1,0,-3);
+        s2.r = 1;
+        s2.col=Blue()+Color(0,0.3,0) + Color(0.7,0,0);
+
+        Sphere s3;
+        s3.c = Point(-3,0,-3);
+        s3.r = 1;
+        s3.col=Yellow();
+
+        Sphere s4;
+        s4.c = Point(0,0,-2);
+        s4.r = 1;
+        s4.col=Yellow()+Color(0.2,0,0.5);
+
+        Plan p;
+        p.a = Point(0,-1, 0);
+        p.n = Vector(0, 1, 0);
+        p.col = Green()-Color(0,0.3,0) + Color(0.1,0,0.1);
+
+        Lumiere lum1;
+        lum1.dirL = Vector(1,0.5,0);
+        lum1.col = Color(0.7,0.1,0.3);//Blue()- Color(0,0,0.2);//Red()+ Color(0,0,0.5)-Color(0.2,0,0);
+
+        Lumiere lum2;
+        lum2.dirL = Vector(-1,0.5,0);
+        lum2.col = Color(0.2,0.1,0.5);//Blue()- Color(0,0,0.1);
+
+        scene.spheres.push_back(s1);
+        scene.spheres.push_back(s2);
+        scene.spheres.push_back(s3);
+        scene.spheres.push_back(s4);
+
+        scene.plans.push_back(p);
+        scene.lums.push_back(lum1);
+        scene.lums.push_back(lum2);
+
+        scene.build();
+    }
 
-        if(t3!=inf&&t3<interScene.t&&t3<t1&&t3<t2)
+    if(objet)
+    {
+        MeshIOData data = read_meshio_data(objet);
+        if(data.positions.empty())
         {
-            Point interSphere = o + t3*d;
-            imageJour(px, py) = soleil(scene, scene.spheres[2].col, Vector(scene.spheres[2].c, interSphere));
+            printf("[error] loading mesh '%s'...\n", objet);
+            return 1;
         }
 
-        Hit inter_sphere_s4 = intersect_sphere_hit(scene.spheres[3], o,d);
-        if(inter_sphere_s4.t !=inf)
-        {
-            imageJour(px, py) = soleil(scene, inter_sphere_s4.color, inter_sphere_s4.n);
-        }
+        // place l'objet a droite des spheres, pose sur le plan, dans un cube de cote 2
+        BBox bounds;
+        for(const Point& q : data.positions)
+            bounds.insert(q);
+        Vector d = Vector(bounds.pmin, bounds.pmax);
+        float taille = std::max(d.x, std::max(d.y, d.z));
+        Point base = Point(bounds.centroid().x, bounds.pmin.y, bounds.centroid().z);
+        scene.add_mesh(data, Translation(3, -1, -3) * Scale(2 / taille) * Translation(Vector(base, Point())), objet);
+        scene.build_triangles();
+    }
 
-        if(t1==inf&&t2==inf&&t3==inf&&inter_sphere_s4.t==inf&&interScene.t==inf)
-        {
-            imageJour(px, py)=couleurCielInterpole(d, scene.lums[0], scene.lums[1]);
-        }
+    if(fichier_export && !write_scene(fichier_export, scene, vue))
+        return 1;
 
+    Camera camera(imageJour.width(), imageJour.height(), vue);
 
-    }}
+    // rendu parallele, par tuiles
+    if(echantillons > 0)
+    {
+        // rendu progressif, plusieurs rayons par pixel
+        Accumulation accumulation(imageJour.width(), imageJour.height());
+        long int rayons = render_progressive(accumulation,
+            [&](const float x, const float y)
+            {
+                return couleur_pixel(scene, camera, x, y);
+            },
+            echantillons, seuil);
 
-    write_image_preview(imageJour, "images/image_soiree.png");
-    filtre_image(imageJour,Blue(), 0.05, 7);
+        accumulation.resolve(imageJour);
+        printf("%.2f rayons par pixel\n", float(rayons) / float(imageJour.width() * imageJour.height()));
+    }
+    else if(paquets)
+        rendu_paquets(imageJour, scene, camera);
+    else
+        render_tiles(imageJour,
+            [&](const int px, const int py)
+            {
+                return couleur_pixel(scene, camera, px, py);
+            });
 
-    write_image_preview(imageJour, "images/image_nuit.png");
+    // post-traitement des 2 images en un seul parcours : la soiree, et la nuit avec un effet de bloom bleu
+    write_images_preview(imageJour, {
+        PreviewOutput("images/image_soiree.png"),
+        PreviewOutput("images/image_nuit.png", Bloom(Blue(), 0.05, 7)) });
     return 0;
 }
 
@@ -0,0 +1,378 @@
+
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+
+#include "qoi.h"
+#include "mapped_file.h"
+
+
+namespace {
+
+// operations de l'encodage, cf https://qoiformat.org/qoi-specification.pdf
+const unsigned char QOI_OP_INDEX= 0x00;
+const unsigned char QOI_OP_DIFF= 0x40;
+const unsigned char QOI_OP_LUMA= 0x80;
+const unsigned char QOI_OP_RUN= 0xc0;
+const unsigned char QOI_OP_RGB= 0xfe;
+const unsigned char QOI_OP_RGBA= 0xff;
+const unsigned char QOI_MASK= 0xc0;
+
+const int QOI_HEADER_SIZE= 14;
+const unsigned char QOI_END[8]= { 0, 0, 0, 0, 0, 0, 0, 1 };
+// marque la table des blocs, apres le marqueur de fin
+const char QOI_BLOCKS[4]= { 'q', 'b', 'l', 'k' };
+// nombre de pixels approximatif d'un bloc, encode ou decode par un thread
+const int QOI_BLOCK_PIXELS= 64 * 1024;
+
+struct Pixel
+{
+    unsigned char r, g, b, a;
+};
+
+inline bool operator== ( const Pixel& p, const Pixel& q ) { return p.r == q.r && p.g == q.g && p.b == q.b && p.a == q.a; }
+inline int hash( const Pixel& p ) { return (p.r * 3 + p.g * 5 + p.b * 7 + p.a * 11) % 64; }
+
+void write_u32( std::vector<unsigned char>& out, const uint32_t v )
+{
+    out.push_back(uint8_t(v >> 24));
+    out.push_back(uint8_t(v >> 16));
+    out.push_back(uint8_t(v >> 8));
+    out.push_back(uint8_t(v));
+}
+
+uint32_t read_u32( const unsigned char *p )
+{
+    return (uint32_t(p[0]) << 24) | (uint32_t(p[1]) << 16) | (uint32_t(p[2]) << 8) | uint32_t(p[3]);
+}
+
+/* encode les lignes [y0 .. y1[. le bloc commence par un pixel complet (QOI_OP_RGBA) et n'utilise que les couleurs de l'index affectees dans le bloc :
+    un decodeur sequentiel, qui continue avec l'etat du bloc precedent, et un decodeur qui commence au debut du bloc, produisent les memes pixels.
+ */
+std::vector<unsigned char> encode_block( const unsigned char *pixels, const int width, const int height, const int y0, const int y1, const bool flipY )
+{
+    std::vector<unsigned char> out;
+    out.reserve(size_t(y1 - y0) * width * 5);
+
+    Pixel index[64]= {};
+    uint64_t valid= 0;
+    Pixel prev= { 0, 0, 0, 255 };
+    int run= 0;
+    bool first= true;
+    for(int y= y0; y < y1; y++)
+    {
+        int source= flipY ? height -1 - y : y;
+        const unsigned char *row= pixels + size_t(source) * width * 4;
+        for(int x= 0; x < width; x++)
+        {
+            Pixel px= { row[4*x], row[4*x +1], row[4*x +2], row[4*x +3] };
+            if(!first && px == prev)
+            {
+                run++;
+                if(run == 62)
+                {
+                    out.push_back(QOI_OP_RUN | (run -1));
+                    run= 0;
+                }
+                continue;
+            }
+
+            if(run > 0)
+            {
+                out.push_back(QOI_OP_RUN | (run -1));
+                run= 0;
+            }
+
+            int h= hash(px);
+            if(!first && (valid & (uint64_t(1) << h)) && index[h] == px)
+                out.push_back(QOI_OP_INDEX | h);
+            else
+            {
+                index[h]= px;
+                valid|= uint64_t(1) << h;
+
+                if(!first && px.a == prev.a)
+                {
+                    signed char vr= px.r - prev.r;
+                    signed char vg= px.g - prev.g;
+                    signed char vb= px.b - prev.b;
+                    signed char vg_r= vr - vg;
+                    signed char vg_b= vb - vg;
+
+                    if(vr > -3 && vr < 2 && vg > -3 && vg < 2 && vb > -3 && vb < 2)
+                        out.push_back(QOI_OP_DIFF | (vr + 2) << 4 | (vg + 2) << 2 | (vb + 2));
+                    else if(vg_r > -9 && vg_r < 8 && vg > -33 && vg < 32 && vg_b > -9 && vg_b < 8)
+                    {
+                        out.push_back(QOI_OP_LUMA | (vg + 32));
+                        out.push_back((vg_r + 8) << 4 | (vg_b + 8));
+                    }
+                    else
+                    {
+                        out.push_back(QOI_OP_RGB);
+                        out.push_back(px.r);
+                        out.push_back(px.g);
+                        out.push_back(px.b);
+                    }
+                }
+                else
+                {
+                    out.push_back(QOI_OP_RGBA);
+                    out.push_back(px.r);
+                    out.push_back(px.g);
+                    out.push_back(px.b);
+                    out.push_back(px.a);
+                }
+            }
+
+            prev= px;
+            first= false;
+        }
+    }
+
+    if(run > 0)
+        out.push_back(QOI_OP_RUN | (run -1));
+
+    return out;
+}
+
+// decodeur, etat initial du debut d'un fichier ou d'un bloc
+struct Decoder
+{
+    const unsigned char *p;
+    const unsigned char *end;
+    Pixel index[64];
+    Pixel px;
+    int run;
+    bool error;
+
+    Decoder( const unsigned char *begin, const unsigned char *_end ) : p(begin), end(_end), index(), px({ 0, 0, 0, 255 }), run(0), error(false) {}
+
+    Pixel next( )
+    {
+        if(run > 0)
+        {
+            run--;
+            return px;
+        }
+
+        if(p >= end)
+        {
+            error= true;
+            return px;
+        }
+
+        unsigned char op= *p++;
+        if(op == QOI_OP_RGB)
+        {
+            if(end - p < 3) { error= true; return px; }
+            px.r= p[0]; px.g= p[1]; px.b= p[2];
+            p+= 3;
+        }
+        else if(op == QOI_OP_RGBA)
+        {
+            if(end - p < 4) { error= true; return px; }
+            px.r= p[0]; px.g= p[1]; px.b= p[2]; px.a= p[3];
+            p+= 4;
+        }
+        else if((op & QOI_MASK) == QOI_OP_INDEX)
+            px= index[op];
+        else if((op & QOI_MASK) == QOI_OP_DIFF)
+        {
+            px.r+= ((op >> 4) & 0x03) - 2;
+            px.g+= ((op >> 2) & 0x03) - 2;
+            px.b+= ( op       & 0x03) - 2;
+        }
+        else if((op & QOI_MASK) == QOI_OP_LUMA)
+        {
+            if(p >= end) { error= true; return px; }
+            int vg= (op & 0x3f) - 32;
+            int b2= *p++;
+            px.r+= vg - 8 + ((b2 >> 4) & 0x0f);
+            px.g+= vg;
+            px.b+= vg - 8 +  (b2       & 0x0f);
+        }
+        else
+            run= op & 0x3f;
+
+        index[hash(px)]= px;
+        return px;
+    }
+};
+
+// decode les lignes [y0 .. y1[
+bool decode_rows( Decoder& decoder, unsigned char *pixels, const int width, const int height, const int y0, const int y1, const bool flipY )
+{
+    for(int y= y0; y < y1; y++)
+    {
+        int target= flipY ? height -1 - y : y;
+        unsigned char *row= pixels + size_t(target) * width * 4;
+        for(int x= 0; x < width; x++)
+        {
+            Pixel px= decoder.next();
+            row[4*x]= px.r;
+            row[4*x +1]= px.g;
+            row[4*x +2]= px.b;
+            row[4*x +3]= px.a;
+        }
+
+        if(decoder.error)
+            return false;
+    }
+
+    return true;
+}
+
+}
+
+
+bool write_qoi( const unsigned char *pixels, const int width, const int height, const char *filename, const bool flipY )
+{
+    if(width <= 0 || height <= 0)
+        return false;
+
+    // encode les blocs de lignes, en parallele. le decoupage ne depend pas du nombre de threads
+    const int rows= std::max(1, QOI_BLOCK_PIXELS / width);
+    const int n= (height + rows -1) / rows;
+    std::vector< std::vector<unsigned char> > blocks(n);
+    #pragma omp parallel for schedule(dynamic, 1)
+    for(int i= 0; i < n; i++)
+        blocks[i]= encode_block(pixels, width, height, i * rows, std::min(height, (i+1) * rows), flipY);
+
+    std::vector<unsigned char> header;
+    header.insert(header.end(), { 'q', 'o', 'i', 'f' });
+    write_u32(header, uint32_t(width));
+    write_u32(header, uint32_t(height));
+    header.push_back(4);        // rgba
+    header.push_back(0);        // srgb, alpha lineaire
+
+    // table des blocs : position de chaque bloc dans le fichier, lignes par bloc, nombre de blocs
+    std::vector<unsigned char> table;
+    uint64_t offset= QOI_HEADER_SIZE;
+    for(int i= 0; i < n; i++)
+    {
+        write_u32(table, uint32_t(offset >> 32));
+        write_u32(table, uint32_t(offset));
+        offset+= blocks[i].size();
+    }
+    write_u32(table, uint32_t(rows));
+    write_u32(table, uint32_t(n));
+    table.insert(table.end(), QOI_BLOCKS, QOI_BLOCKS + 4);
+
+    FILE *out= fopen(filename, "wb");
+    if(!out)
+    {
+        printf("[error] writing qoi '%s'...\n", filename);
+        return false;
+    }
+
+    bool code= fwrite(header.data(), 1, header.size(), out) == header.size();
+    for(int i= 0; i < n && code; i++)
+        code= blocks[i].empty() || fwrite(blocks[i].data(), 1, blocks[i].size(), out) == blocks[i].size();
+    code= code && fwrite(QOI_END, 1, 8, out) == 8;
+    code= code && fwrite(table.data(), 1, table.size(), out) == table.size();
+
+    if(fclose(out) != 0 || !code)
+    {
+        printf("[error] writing qoi '%s'...\n", filename);
+        return false;
+    }
+
+    return true;
+}
+
+
+bool read_qoi( const char *filename, std::vector<unsigned char>& pixels, int& width, int& height, const bool flipY )
+{
+    pixels.clear();
+    width= 0;
+    height= 0;
+
+    std::shared_ptr<MappedFile> file= map_file(filename);
+    if(!file)
+        return false;
+
+    const unsigned char *data= (const unsigned char *) file->data();
+    const size_t size= file->size();
+    if(size < QOI_HEADER_SIZE + 8 || memcmp(data, "qoif", 4) != 0 || (data[12] != 3 && data[12] != 4))
+    {
+        printf("[error] loading qoi '%s': not a qoi file...\n", filename);
+        return false;
+    }
+
+    uint32_t w= read_u32(data + 4);
+    uint32_t h= read_u32(data + 8);
+    if(w == 0 || h == 0 || uint64_t(w) * h > 400000000u)
+    {
+        printf("[error] loading qoi '%s': bad size %ux%u...\n", filename, w, h);
+        return false;
+    }
+
+    width= int(w);
+    height= int(h);
+    pixels.resize(size_t(w) * h * 4);
+
+    // table des blocs ?
+    int rows= 0;
+    int n= 0;
+    std::vector<uint64_t> offsets;
+    if(size >= QOI_HEADER_SIZE + 8 + 12 && memcmp(data + size - 4, QOI_BLOCKS, 4) == 0)
+    {
+        rows= int(read_u32(data + size - 12));
+        n= int(read_u32(data + size - 8));
+        uint64_t table= size - 12 - 8 * uint64_t(n);
+        if(rows > 0 && n == (height + rows -1) / rows && table >= QOI_HEADER_SIZE + 8 && table <= size)
+        {
+            offsets.resize(n +1);
+            for(int i= 0; i < n; i++)
+                offsets[i]= (uint64_t(read_u32(data + table + 8*i)) << 32) | read_u32(data + table + 8*i + 4);
+            // fin du dernier bloc : marqueur de fin
+            offsets[n]= table - 8;
+
+            // table incorrecte : decodage sequentiel
+            bool valid= true;
+            for(int i= 0; i < n; i++)
+            {
+                if(offsets[i] < QOI_HEADER_SIZE || offsets[i] > offsets[i +1])
+                {
+                    valid= false;
+                    break;
+                }
+            }
+            if(!valid)
+                offsets.clear();
+        }
+    }
+
+    bool code= true;
+    if(!offsets.empty())
+    {
+        // decode les blocs en parallele
+        #pragma omp parallel for schedule(dynamic, 1)
+        for(int i= 0; i < n; i++)
+        {
+            Decoder decoder(data + offsets[i], data + offsets[i +1]);
+            if(!decode_rows(decoder, pixels.data(), width, height, i * rows, std::min(height, (i+1) * rows), flipY))
+            {
+                #pragma omp atomic write
+                code= false;
+            }
+        }
+    }
+    else
+    {
+        Decoder decoder(data + QOI_HEADER_SIZE, data + size);
+        code= decode_rows(decoder, pixels.data(), width, height, 0, height, flipY);
+    }
+
+    if(!code)
+    {
+        printf("[error] loading qoi '%s': corrupted data...\n", filename);
+        pixels.clear();
+        width= 0;
+        height= 0;
+        return false;
+    }
+
+    return true;
+}
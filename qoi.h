@@ -0,0 +1,26 @@
+
+#ifndef _QOI_H
+#define _QOI_H
+
+#include <vector>
+
+
+//! \addtogroup image
+///@{
+
+//! \file
+//! images .qoi (quite ok image format) : compression sans perte, rapide, pour les images intermediaires. encodage et decodage paralleles, par blocs de lignes.
+
+/*! enregistre une image 8 bits rgba, width x height pixels, au format .qoi.
+    les blocs de lignes sont encodes en parallele : chaque bloc commence par un pixel complet et n'utilise que les couleurs deja vues dans le bloc,
+    le fichier reste lisible par un decodeur .qoi standard. la position des blocs est ajoutee apres le marqueur de fin, pour les decoder en parallele, cf read_qoi().
+*/
+bool write_qoi( const unsigned char *pixels, const int width, const int height, const char *filename, const bool flipY= true );
+
+/*! charge une image .qoi, 8 bits rgba, width x height pixels.
+    les blocs d'un fichier ecrit par write_qoi() sont decodes en parallele, les autres fichiers .qoi sont decodes sequentiellement.
+*/
+bool read_qoi( const char *filename, std::vector<unsigned char>& pixels, int& width, int& height, const bool flipY= true );
+
+///@}
+#endif
@@ -0,0 +1,101 @@
+
+#ifndef _RENDER_H
+#define _RENDER_H
+
+#include <algorithm>
+
+#include "image.h"
+
+
+//! \addtogroup image
+///@{
+
+//! \file
+//! rendu parallele d'une image, decoupee en tuiles.
+
+//! taille par defaut des tuiles, en pixels.
+const int TILE_SIZE= 32;
+
+//! region rectangulaire de l'image, pixels [x0 .. x1[ x [y0 .. y1[.
+struct Tile
+{
+    int x0, y0;
+    int x1, y1;
+};
+
+//! renvoie le nombre de tuiles necessaires pour couvrir une image width x height.
+inline int tile_count( const int width, const int height, const int size= TILE_SIZE )
+{
+    int nx= (width + size -1) / size;
+    int ny= (height + size -1) / size;
+    return nx * ny;
+}
+
+//! renvoie le nombre de tuiles necessaires pour couvrir l'image.
+inline int tile_count( const Image& image, const int size= TILE_SIZE ) { return tile_count(image.width(), image.height(), size); }
+
+//! renvoie la tuile d'indice id d'une image width x height, les tuiles sont numerotees ligne par ligne.
+inline Tile tile( const int width, const int height, const int id, const int size= TILE_SIZE )
+{
+    int nx= (width + size -1) / size;
+
+    Tile t;
+    t.x0= (id % nx) * size;
+    t.y0= (id / nx) * size;
+    t.x1= std::min(t.x0 + size, width);
+    t.y1= std::min(t.y0 + size, height);
+    return t;
+}
+
+//! renvoie la tuile d'indice id, les tuiles sont numerotees ligne par ligne.
+inline Tile tile( const Image& image, const int id, const int size= TILE_SIZE ) { return tile(image.width(), image.height(), id, size); }
+
+/*! execute fonction(tuile) sur toutes les tuiles d'une image width x height, en parallele.
+    les tuiles sont distribuees dynamiquement aux threads openmp : un thread qui termine une tuile recupere la suivante,
+    ce qui equilibre la charge entre les regions vides (ciel) et les regions couteuses de l'image.
+*/
+template < typename Function >
+void for_each_tile( const int width, const int height, Function fonction, const int size= TILE_SIZE )
+{
+    const int n= tile_count(width, height, size);
+
+#pragma omp parallel for schedule(dynamic, 1)
+    for(int i= 0; i < n; i++)
+        fonction(tile(width, height, i, size));
+}
+
+//! execute fonction(tuile) sur toutes les tuiles de l'image, en parallele.
+template < typename Function >
+void for_each_tile( const Image& image, Function fonction, const int size= TILE_SIZE )
+{
+    for_each_tile(image.width(), image.height(), fonction, size);
+}
+
+/*! calcule la couleur de chaque pixel de l'image, en parallele.
+    chaque tuile est calculee par un seul thread, les pixels sont ecrits directement dans l'image, sans synchronisation.
+
+    exemple :
+    \code
+    Image image(1024, 512);
+    render_tiles(image,
+        [&]( const int px, const int py )
+        {
+            return Color(float(px) / image.width(), float(py) / image.height(), 0);
+        });
+    \endcode
+*/
+template < typename Shader >
+void render_tiles( Image& image, Shader shader, const int size= TILE_SIZE )
+{
+    for_each_tile(image,
+        [&]( const Tile& t )
+        {
+            for(int py= t.y0; py < t.y1; py++)
+            for(int px= t.x0; px < t.x1; px++)
+                image(px, py)= shader(px, py);
+        },
+        size);
+}
+
+///@}
+#endif
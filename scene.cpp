@@ -0,0 +1,345 @@
+
+#include <cassert>
+#include <cmath>
+
+#include "scene.h"
+#include "simd.h"
+
+
+void Scene::add_mesh( const MeshIOData& data, const Transform& model, const char *filename )
+{
+    if(filename)
+        instances.push_back( { filename, model } );
+
+    int first= int(mesh.positions.size());
+    int n= int(data.positions.size());
+    Transform normal= model.normal();
+
+    for(int i= 0; i < n; i++)
+        mesh.positions.push_back( model(data.positions[i]) );
+
+    // les normales et les coordonnees de textures restent indexees comme les positions : completees par des 0 pour les objets qui n'en ont pas
+    if(data.normals.size() == data.positions.size())
+    {
+        mesh.normals.resize(first, Vector());
+        for(int i= 0; i < n; i++)
+            mesh.normals.push_back( normal(data.normals[i]) );
+    }
+    else if(!mesh.normals.empty())
+        mesh.normals.resize(first + n, Vector());
+
+    if(data.texcoords.size() == data.positions.size())
+    {
+        mesh.texcoords.resize(first, Point());
+        mesh.texcoords.insert(mesh.texcoords.end(), data.texcoords.begin(), data.texcoords.end());
+    }
+    else if(!mesh.texcoords.empty())
+        mesh.texcoords.resize(first + n, Point());
+
+    for(int index : data.indices)
+        mesh.indices.push_back(first + index);
+
+    // matieres de l'objet, et leurs textures, renumerotees dans celles de la scene
+    std::vector<int> remap(data.materials.count());
+    for(int i= 0; i < data.materials.count(); i++)
+    {
+        Material material= data.materials(i);
+        int *textures[]= { &material.diffuse_texture, &material.specular_texture, &material.ns_texture };
+        for(int *texture : textures)
+            if(*texture != -1)
+                *texture= mesh.materials.insert_texture(data.materials.filename(*texture));
+
+        remap[i]= mesh.materials.insert(material, data.materials.name(i));
+    }
+
+    for(int id : data.material_indices)
+        mesh.material_indices.push_back( (id < 0) ? mesh.materials.default_material_index() : remap[id] );
+}
+
+bool Scene::load_textures( const size_t max_bytes, const std::string& directory )
+{
+    textures= std::make_shared<TextureCache>(max_bytes, directory);
+    return textures->add(mesh.materials);
+}
+
+void Scene::build( )
+{
+    build_spheres();
+    build_triangles();
+}
+
+void Scene::build_spheres( )
+{
+    std::vector<BBox> bounds;
+    bounds.reserve(spheres.size());
+    for(const auto& sphere : spheres)
+    {
+        Vector r= Vector(sphere.r, sphere.r, sphere.r);
+        bounds.push_back( BBox(sphere.c - r, sphere.c + r) );
+    }
+
+    // une feuille contient au plus un groupe de spheres, testees ensemble par intersect_spheres_soa()
+    bvh.build(bounds, SIMD_WIDTH);
+    soa.build(spheres, bvh.indices);
+}
+
+void Scene::build_triangles( )
+{
+    // meme chose que pour les spheres
+    int n= int(mesh.indices.size() / 3);
+    std::vector<BBox> bounds;
+    bounds.reserve(n);
+    for(int i= 0; i < n; i++)
+    {
+        const Point& a= mesh.positions[mesh.indices[3*i]];
+        BBox box= BBox(a, a);
+        box.insert(mesh.positions[mesh.indices[3*i +1]]);
+        box.insert(mesh.positions[mesh.indices[3*i +2]]);
+        bounds.push_back(box);
+    }
+
+    mesh_bvh.build(bounds, SIMD_WIDTH);
+    triangles.build(mesh, mesh_bvh.indices);
+}
+
+
+float intersect_sphere (const Point &c, const float &r, const Point &o, const Vector &d)
+{
+    Vector oc = Vector(c,o);
+    float a = dot(d,d);
+    float b = dot(d, oc);           // b/2, evite les facteurs 2 et 4
+    float k = dot(oc, oc)- r*r;
+    float delta = b*b-a*k;
+    if(delta<0)
+        return inf;
+
+    float s = std::sqrt(delta);
+    float t1 = (-b - s)/a;
+    float t2 = (-b + s)/a;
+
+    // a > 0, donc t1 <= t2 : la plus petite racine positive est t1, ou t2 si t1 est derriere l'origine
+    float t = (t1>=0) ? t1 : t2;
+    return (t>=0) ? t : inf;
+}
+
+Hit intersect_sphere_hit(const Sphere s, const Point &o, const Vector &d)
+{
+    float t = intersect_sphere(s.c, s.r, o, d);
+    if(t==inf) return {};
+    Point p = o + t*d;
+    return Hit(t, p, Vector(s.c, p), s.col, SPHERE);
+}
+
+Hit intersect_spheres_hit(const Scene &scene, const Point &o, const Vector &d)
+{
+    assert(scene.bvh.nodes.size() || scene.spheres.empty());   // Scene::build() ?
+
+    int plus_proche= -1;
+    float tmax= inf;
+    scene.bvh.intersect(o, d, tmax,
+        [&](const int begin, const int end, float& tmax)
+        {
+            int id = intersect_spheres_soa(scene.soa, begin, end, o, d, tmax);
+            if(id != -1)
+                plus_proche = id;
+            return false;
+        });
+
+    if(plus_proche == -1)
+        return {};
+
+    int id = scene.soa.ids[plus_proche];
+    const Sphere& sphere = scene.spheres[id];
+    Point p = o + tmax*d;
+    return Hit(tmax, p, Vector(sphere.c, p), sphere.col, SPHERE, id);
+}
+
+float intersect_spheres(const Scene &scene, const Point &o, const Vector &d)
+{
+    assert(scene.bvh.nodes.size() || scene.spheres.empty());   // Scene::build() ?
+
+    float tmin = inf;
+    scene.bvh.intersect(o, d, tmin,
+        [&](const int begin, const int end, float& tmax)
+        {
+            intersect_spheres_soa(scene.soa, begin, end, o, d, tmax);
+            return false;
+        });
+
+    return tmin;
+}
+
+bool occluded_spheres(const Scene &scene, const Point &o, const Vector &d, const float tmax)
+{
+    assert(scene.bvh.nodes.size() || scene.spheres.empty());   // Scene::build() ?
+
+    float t = tmax;
+    return scene.bvh.intersect(o, d, t,
+        [&](const int begin, const int end, float& tmax)
+        {
+            // premier obstacle, inutile de continuer
+            return occluded_spheres_soa(scene.soa, begin, end, o, d, tmax);
+        });
+}
+
+Hit triangle_hit(const Scene &scene, const int id, const Point &o, const Vector &d, const float t, const float u, const float v)
+{
+    const MeshIOData& mesh = scene.mesh;
+    int a = mesh.indices[3*id];
+    int b = mesh.indices[3*id +1];
+    int c = mesh.indices[3*id +2];
+
+    Vector n;
+    if(mesh.normals.size() == mesh.positions.size())
+        n = (1 - u - v) * mesh.normals[a] + u * mesh.normals[b] + v * mesh.normals[c];
+    if(length2(n) == 0)
+        // pas de normales par sommet, normale geometrique
+        n = cross(Vector(mesh.positions[a], mesh.positions[b]), Vector(mesh.positions[a], mesh.positions[c]));
+    if(dot(n, d) > 0)
+        n = -n;
+
+    Hit h(t, o + t*d, n, mesh.materials(mesh.material_indices[id]).diffuse, TRIANGLE, id);
+    h.u = u;
+    h.v = v;
+    return h;
+}
+
+Color triangle_texture(const Scene &scene, const Hit &hit, const Vector &d, const float cone_width)
+{
+    const MeshIOData& mesh = scene.mesh;
+    if(hit.objet != TRIANGLE || mesh.texcoords.size() != mesh.positions.size())
+        return hit.color;
+
+    // textures du cache, ou textures chargees par read_images()
+    const TextureCache *cache = scene.textures.get();
+    int texture = mesh.materials(mesh.material_indices[hit.id]).diffuse_texture;
+    if(texture < 0)
+        return hit.color;
+    if(cache && (texture >= cache->count() || cache->levels(texture) == 0))
+        return hit.color;
+    if(!cache && (texture >= int(mesh.images.size()) || mesh.images[texture].levels() == 0))
+        return hit.color;
+
+    int a = mesh.indices[3*hit.id];
+    int b = mesh.indices[3*hit.id +1];
+    int c = mesh.indices[3*hit.id +2];
+    const Point& ta = mesh.texcoords[a];
+    const Point& tb = mesh.texcoords[b];
+    const Point& tc = mesh.texcoords[c];
+    float u = (1 - hit.u - hit.v) * ta.x + hit.u * tb.x + hit.v * tc.x;
+    float v = (1 - hit.u - hit.v) * ta.y + hit.u * tb.y + hit.v * tc.y;
+
+    // aires du triangle dans la scene et dans la texture, et angle entre le rayon et le triangle
+    Vector n = cross(Vector(mesh.positions[a], mesh.positions[b]), Vector(mesh.positions[a], mesh.positions[c]));
+    float triangle_area = length(n) / 2;
+    float texcoord_area = std::abs((tb.x - ta.x) * (tc.y - ta.y) - (tc.x - ta.x) * (tb.y - ta.y)) / 2;
+    float cos_theta = (triangle_area > 0) ? dot(n, d) / (2 * triangle_area * length(d)) : 1;
+
+    if(cache)
+    {
+        float lod = ray_cone_lod(cone_width, cos_theta, triangle_area, texcoord_area, cache->width(texture), cache->height(texture));
+        return hit.color * cache->texture(texture, u, v, lod);
+    }
+
+    const MipmapRGBA8& image = mesh.images[texture];
+    float lod = ray_cone_lod(cone_width, cos_theta, triangle_area, texcoord_area, image.width(), image.height());
+    return hit.color * image.texture(u, v, lod);
+}
+
+Hit intersect_plan(const Plan &p, const Point& o, const Vector& d)
+{
+    float t = dot(p.n,Vector(o,p.a))/dot(p.n,d);
+    if (t<0) return {};
+    return Hit(t, o + t*d, p.n, p.col, PLAN);
+}
+
+Hit intersect_plan_hit(const Scene& scene, const Point& o, const Vector& d )
+{
+    Hit plus_proche;
+    plus_proche.t = inf;
+    for(int i= 0; i<int(scene.plans.size()); i++)
+    {
+        Hit h= intersect_plan(scene.plans[i], o, d);//, plus_proche.t);
+        if(h.t<plus_proche.t && h.t>0)
+        {
+            plus_proche= h;
+            plus_proche.id= i;
+        }
+    }
+
+    return plus_proche;
+}
+
+
+Hit intersect(const Scene &scene, const Ray &ray, const float tmax)
+{
+    Hit plus_proche;
+    float t = tmax;
+
+    // les plans en premier : ils sont moins chers a tester et raccourcissent le rayon avant le parcours des bvh
+    for(int i = 0; i < int(scene.plans.size()); i++)
+    {
+        Hit h = intersect_plan(scene.plans[i], ray.o, ray.d);
+        if(h.t>0 && h.t<t)
+        {
+            t = h.t;
+            plus_proche = h;
+            plus_proche.id = i;
+        }
+    }
+
+    int sphere = -1;
+    scene.bvh.intersect(ray.o, ray.d, t,
+        [&](const int begin, const int end, float& tmax)
+        {
+            int id = intersect_spheres_soa(scene.soa, begin, end, ray.o, ray.d, tmax);
+            if(id != -1)
+                sphere = id;
+            return false;
+        });
+
+    if(sphere != -1)
+    {
+        int id = scene.soa.ids[sphere];
+        const Sphere& s = scene.spheres[id];
+        Point p = ray(t);
+        plus_proche = Hit(t, p, Vector(s.c, p), s.col, SPHERE, id);
+    }
+
+    // les triangles, avec le rayon raccourci par le plan et les spheres
+    int triangle = -1;
+    float u = 0, v = 0;
+    scene.mesh_bvh.intersect(ray.o, ray.d, t,
+        [&](const int begin, const int end, float& tmax)
+        {
+            int id = intersect_triangles_soa(scene.triangles, begin, end, ray.o, ray.d, tmax, u, v);
+            if(id != -1)
+                triangle = id;
+            return false;
+        });
+
+    if(triangle != -1)
+        plus_proche = triangle_hit(scene, scene.triangles.ids[triangle], ray.o, ray.d, t, u, v);
+
+    return plus_proche;
+}
+
+bool occluded(const Scene &scene, const Ray &ray, const float tmax)
+{
+    for(const Plan& plan : scene.plans)
+    {
+        float t = dot(plan.n, Vector(ray.o, plan.a)) / dot(plan.n, ray.d);
+        if(t>0 && t<tmax)
+            return true;
+    }
+
+    if(occluded_spheres(scene, ray.o, ray.d, tmax))
+        return true;
+
+    float ttriangles = tmax;
+    return scene.mesh_bvh.intersect(ray.o, ray.d, ttriangles,
+        [&](const int begin, const int end, float& tmax)
+        {
+            return occluded_triangles_soa(scene.triangles, begin, end, ray.o, ray.d, tmax);
+        });
+}
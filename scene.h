@@ -0,0 +1,164 @@
+
+#ifndef _SCENE_H
+#define _SCENE_H
+
+#include <vector>
+#include <limits>
+#include <string>
+
+#include "vec.h"
+#include "color.h"
+#include "buffer.h"
+#include "bvh.h"
+#include "sphere_soa.h"
+#include "triangles.h"
+#include "mat.h"
+#include "mesh_io.h"
+#include "texture_cache.h"
+
+
+//! \file
+//! description de la scene : spheres, plans, triangles, lumieres, et intersections avec un rayon.
+
+const float inf= std::numeric_limits<float>::infinity();
+
+struct Sphere
+{
+    Point c; //centre
+    float r; //rayon
+    Color col; //couleur
+};
+
+struct Plan
+{
+    Point a; //point
+    Vector n; //normal passant par a
+    Color col; //couleur plan
+};
+
+struct Lumiere
+{
+    Vector dirL;
+    Color col;
+};
+
+//! rayon o + t*d.
+struct Ray
+{
+    Point o;    // origine
+    Vector d;   // direction, pas forcement normalisee
+
+    Ray( ) : o(), d() {}
+    Ray(const Point &origine, const Vector &direction) : o(origine), d(direction) {}
+
+    //! renvoie le point o + t*d.
+    Point operator() (const float t) const { return o + t*d; }
+};
+
+//! type d'objet touche par un rayon, cf Hit.
+enum Objet
+{
+    RIEN= 0,
+    SPHERE,
+    PLAN,
+    TRIANGLE
+};
+
+struct Hit
+{
+    float t;        // position sur le rayon, ou inf s'il n'y a pas d'intersection
+    Point p;        // position du point, s'il existe
+    Vector n;       // normale du point d'intersection, s'il existe
+    Color color;    // couleur du point d'intersection, s'il existe
+    Objet objet;    // type de l'objet touche, ou RIEN
+    int id;         // indice de l'objet touche, dans Scene::spheres, Scene::plans ou les triangles de Scene::mesh, ou -1
+    float u, v;     // coordonnees barycentriques du point, pour les triangles
+
+    Hit( ) : t(inf), p(), n(), color(), objet(RIEN), id(-1), u(0), v(0) {}     // pas d'intersection
+    Hit(const float &x, const Point &point, const Vector &norm, const Color &c, const Objet o= RIEN, const int i= -1)
+    {
+        t=x; p=point; n=norm; color=c; objet=o; id=i; u=0; v=0;
+    }
+};
+
+//! objet charge depuis un fichier, et sa transformation, cf Scene::add_mesh() et write_scene().
+struct MeshInstance
+{
+    std::string filename;
+    Transform model;
+};
+
+struct Scene
+{
+    Buffer<Sphere> spheres;     // peut referencer directement les spheres d'un fichier de scene binaire, cf read_scene()
+    std::vector<Plan> plans;
+    std::vector<Lumiere> lums;
+
+    MeshIOData mesh;    // triangles des objets charges par read_meshio_data(), cf add_mesh()
+    std::vector<MeshInstance> instances;    // fichiers des objets ajoutes a mesh
+
+    BVH bvh;    // hierarchie d'englobants des spheres, cf build()
+    SphereSoA soa;  // spheres rangees dans l'ordre des feuilles du bvh, pour les tester par groupes
+    BVH mesh_bvh;   // hierarchie d'englobants des triangles
+    TriangleSoA triangles;  // triangles ranges dans l'ordre des feuilles de mesh_bvh
+    std::shared_ptr<TextureCache> textures;    // textures des matieres de mesh, chargees a la demande, cf load_textures()
+
+    /*! ajoute les triangles d'un objet charge par read_meshio_data(), places dans la scene par la transformation model.
+        les matieres sont ajoutees a celles de la scene, une matiere deja presente (meme nom) n'est pas dupliquee.
+        filename, s'il est connu, est conserve dans instances, pour enregistrer la scene, cf write_scene().
+    */
+    void add_mesh( const MeshIOData& data, const Transform& model= Identity(), const char *filename= nullptr );
+
+    /*! prepare les textures des matieres de mesh dans un cache de taille max_bytes, cf TextureCache : les tuiles sont chargees pendant le rendu, lorsqu'elles sont utilisees.
+        a utiliser a la place de read_images( mesh ), qui charge toutes les textures et leurs mipmaps. a appeler apres avoir ajoute les objets.
+        directory : repertoire des textures tuilees, a cote des images s'il est vide.
+        renvoie faux si une texture n'est pas chargee, elle est remplacee par une texture blanche.
+    */
+    bool load_textures( const size_t max_bytes= size_t(256) * 1024 * 1024, const std::string& directory= std::string() );
+
+    //! construit les bvh et le stockage par composantes des spheres et des triangles. a appeler apres avoir ajoute les objets, avant de calculer des intersections.
+    void build( );
+    //! construit le bvh et le stockage par composantes des spheres, cf build().
+    void build_spheres( );
+    //! construit le bvh et le stockage par composantes des triangles, cf build().
+    void build_triangles( );
+};
+
+/*! intersection la plus proche du rayon avec tous les objets de la scene, pour t dans [0 .. tmax[.
+    le rayon est raccourci a chaque intersection trouvee : les plans sont testes en premier, les spheres et les triangles derriere eux ne sont pas testes.
+    renvoie Hit() si le rayon ne touche rien.
+*/
+Hit intersect(const Scene &scene, const Ray &ray, const float tmax= inf);
+
+/*! renvoie vrai si un objet de la scene coupe le rayon, pour t dans [0 .. tmax[.
+    s'arrete sur le premier obstacle trouve, pas forcement le plus proche, a utiliser pour les rayons d'ombre.
+*/
+bool occluded(const Scene &scene, const Ray &ray, const float tmax= inf);
+
+//! intersection rayon / sphere, renvoie la plus petite position positive sur le rayon, ou inf.
+float intersect_sphere (const Point &c, const float &r, const Point &o, const Vector &d);
+Hit intersect_sphere_hit(const Sphere s, const Point &o, const Vector &d);
+
+//! intersection la plus proche avec les spheres de la scene, parcourt le bvh.
+Hit intersect_spheres_hit(const Scene &scene, const Point &o, const Vector &d);
+//! position de l'intersection la plus proche avec les spheres de la scene, ou inf. parcourt le bvh.
+float intersect_spheres(const Scene &scene, const Point &o, const Vector &d);
+//! renvoie vrai si une sphere de la scene coupe le rayon entre 0 et tmax. s'arrete sur le premier obstacle trouve.
+bool occluded_spheres(const Scene &scene, const Point &o, const Vector &d, const float tmax= inf);
+
+/*! renvoie l'intersection avec le triangle id de Scene::mesh, a la position t du rayon, de coordonnees barycentriques u, v.
+    la normale est interpolee si l'objet en fournit une par sommet, et orientee vers l'origine du rayon : les triangles sont visibles des 2 cotes.
+    la couleur est la couleur diffuse de la matiere du triangle, cf MeshIOData::material_indices.
+*/
+Hit triangle_hit(const Scene &scene, const int id, const Point &o, const Vector &d, const float t, const float u, const float v);
+
+/*! couleur diffuse du triangle touche par un rayon de direction d, filtree par la texture de sa matiere, 
+    si elle est chargee par Scene::load_textures(), ou par read_images( scene.mesh ). renvoie hit.color sinon.
+    le niveau de detail depend de la largeur du cone du rayon a l'intersection, cone_width : camera.spread * hit.t * length(d) pour un rayon primaire, cf ray_cone_lod().
+*/
+Color triangle_texture(const Scene &scene, const Hit &hit, const Vector &d, const float cone_width);
+
+Hit intersect_plan(const Plan &p, const Point& o, const Vector& d);
+Hit intersect_plan_hit(const Scene& scene, const Point& o, const Vector& d );
+
+#endif
@@ -0,0 +1,496 @@
+
+#include <cstdio>
+#include <cstring>
+#include <cctype>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+#ifndef _MSC_VER
+    #include <unistd.h>
+#else
+    #include <direct.h>
+    #define getcwd _getcwd
+#endif
+
+#include "scene_io.h"
+#include "mapped_file.h"
+#include "mesh_io.h"
+#include "files.h"
+#include "simd.h"
+
+
+namespace {
+
+const char scene_magic[8]= { 'S', 'C', 'E', 'N', 'E', 'B', 'I', 'N' };
+const uint32_t scene_version= 1;
+
+// elements supplementaires des tableaux par composantes, au moins SIMD_WIDTH, cf SphereSoA
+const int scene_padding= 16;
+static_assert(SIMD_WIDTH <= scene_padding, "scene_padding doit etre superieur a SIMD_WIDTH");
+
+// alignement des tableaux dans le fichier
+const uint64_t scene_alignment= 64;
+
+// entete du fichier binaire : les tableaux sont reperes par leur position dans le fichier, en octets
+struct SceneHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t padding;
+    uint32_t sphere_size, plan_size, light_size, node_size;   // verifie que le fichier est compatible
+
+    float view[10];     // from, to, up, fov
+
+    uint64_t sphere_count;
+    uint64_t plan_count;
+    uint64_t light_count;
+    uint64_t node_count;
+    uint64_t mesh_count;
+
+    uint64_t spheres, plans, lights;
+    uint64_t nodes, indices;
+    uint64_t cx, cy, cz, r2, ids;   // sphere_count + padding elements, sauf ids
+    uint64_t meshes, names;
+};
+
+// objet reference par le fichier, son nom est stocke dans le bloc names
+struct MeshRecord
+{
+    float model[16];
+    uint64_t name;
+    uint64_t length;
+};
+
+
+bool read_scene_text( const char *filename, Scene& scene, View& view )
+{
+    FILE *in= fopen(filename, "rt");
+    if(!in)
+    {
+        printf("[error] loading scene '%s'...\n", filename);
+        return false;
+    }
+
+    printf("loading scene '%s'...\n", filename);
+
+    char tmp[1024];
+    char line_buffer[1024];
+    bool error= false;
+    for(int l= 1; ; l++)
+    {
+        // charge une ligne du fichier
+        if(!fgets(line_buffer, sizeof(line_buffer), in))
+            break;
+
+        // force la fin de la ligne, au cas ou
+        line_buffer[sizeof(line_buffer) -1]= 0;
+
+        // saute les espaces en debut de ligne
+        char *line= line_buffer;
+        while(*line && isspace(*line))
+            line++;
+
+        if(line[0] == 0 || line[0] == '#')
+            continue;   // ligne vide ou commentaire
+
+        float v[12];
+        if(sscanf(line, "sphere %f %f %f %f %f %f %f", &v[0], &v[1], &v[2], &v[3], &v[4], &v[5], &v[6]) == 7)
+        {
+            Sphere sphere;
+            sphere.c= Point(v[0], v[1], v[2]);
+            sphere.r= v[3];
+            sphere.col= Color(v[4], v[5], v[6]);
+            scene.spheres.push_back(sphere);
+        }
+        else if(sscanf(line, "plan %f %f %f %f %f %f %f %f %f", &v[0], &v[1], &v[2], &v[3], &v[4], &v[5], &v[6], &v[7], &v[8]) == 9)
+        {
+            Plan plan;
+            plan.a= Point(v[0], v[1], v[2]);
+            plan.n= Vector(v[3], v[4], v[5]);
+            plan.col= Color(v[6], v[7], v[8]);
+            scene.plans.push_back(plan);
+        }
+        else if(sscanf(line, "lumiere %f %f %f %f %f %f", &v[0], &v[1], &v[2], &v[3], &v[4], &v[5]) == 6)
+        {
+            Lumiere lumiere;
+            lumiere.dirL= Vector(v[0], v[1], v[2]);
+            lumiere.col= Color(v[3], v[4], v[5]);
+            scene.lums.push_back(lumiere);
+        }
+        else if(sscanf(line, "camera %f %f %f %f %f %f %f %f %f %f", &v[0], &v[1], &v[2], &v[3], &v[4], &v[5], &v[6], &v[7], &v[8], &v[9]) == 10)
+            view= View(Point(v[0], v[1], v[2]), Point(v[3], v[4], v[5]), Vector(v[6], v[7], v[8]), v[9]);
+        else if(sscanf(line, "objet %1023s", tmp) == 1)
+        {
+            // position et echelle optionnelles
+            float x= 0, y= 0, z= 0, s= 1;
+            sscanf(line, "objet %*s %f %f %f %f", &x, &y, &z, &s);
+
+            std::string mesh= absolute_filename(pathname(filename), tmp);
+            MeshIOData data= read_meshio_data(mesh.c_str());
+            if(data.positions.empty())
+            {
+                error= true;
+                break;
+            }
+
+            scene.add_mesh(data, Translation(x, y, z) * Scale(s), mesh.c_str());
+        }
+        else
+        {
+            printf("[error] '%s' line %d: '%s'...\n", filename, l, line);
+            error= true;
+            break;
+        }
+    }
+
+    fclose(in);
+    if(error)
+        return false;
+
+    scene.build();
+    return true;
+}
+
+// position dans le fichier du tableau de n elements de taille size, a partir de offset, et deplace offset a la fin du tableau
+uint64_t allocate( uint64_t& offset, const uint64_t n, const uint64_t size )
+{
+    uint64_t begin= (offset + scene_alignment -1) / scene_alignment * scene_alignment;
+    offset= begin + n * size;
+    return begin;
+}
+
+// ecriture sequentielle des tableaux, dans l'ordre de allocate()
+struct SceneWriter
+{
+    FILE *out;
+    uint64_t position;
+
+    // ecrit n elements a la position offset du fichier, complete avec des 0 depuis la fin du tableau precedent
+    bool write( const uint64_t offset, const void *data, const uint64_t n, const uint64_t size )
+    {
+        for(; position < offset; position++)
+            if(fputc(0, out) == EOF)
+                return false;
+
+        position+= n * size;
+        return n == 0 || fwrite(data, size, n, out) == n;
+    }
+
+    // tableau par composantes de n + scene_padding elements
+    bool write_padded( const uint64_t offset, const Buffer<float>& data, const uint64_t n )
+    {
+        std::vector<float> padded(data.begin(), data.begin() + n);
+        padded.resize(n + scene_padding, 0);
+        return write(offset, padded.data(), padded.size(), sizeof(float));
+    }
+};
+
+// verifie que le tableau [offset .. offset + n*size[ est dans le fichier
+bool inside( const MappedFile& file, const uint64_t offset, const uint64_t n, const uint64_t size )
+{
+    return offset <= file.size() && n <= (file.size() - offset) / size;
+}
+
+/* verifie les indices du bvh et du stockage par composantes d'un fichier : ils sont utilises directement par les parcours, sans autre verification.
+    feuilles : [first .. first+count[ dans les n objets, noeuds internes : fils apres le noeud, dans le tableau, profondeur limitee par la pile des parcours,
+    indices et ids dans [0 .. n[.
+ */
+bool valid_bvh( const BVHNode *nodes, const uint64_t node_count, const int *indices, const int *ids, const uint64_t n )
+{
+    if(n > uint64_t(INT32_MAX) || node_count > uint64_t(INT32_MAX) || (n > 0 && node_count == 0))
+        return false;
+
+    // les fils sont toujours ranges apres leur pere, cf BVH::build() : la profondeur se propage dans l'ordre du tableau
+    std::vector<int> depth(node_count, 0);
+    for(uint64_t i= 0; i < node_count; i++)
+    {
+        const BVHNode& node= nodes[i];
+        if(node.count < 0 || node.first < 0)
+            return false;
+
+        if(node.count > 0)
+        {
+            if(uint64_t(node.first) + uint64_t(node.count) > n)
+                return false;
+        }
+        else
+        {
+            if(uint64_t(node.first) <= i || uint64_t(node.first) +1 >= node_count || depth[i] >= BVH_MAX_DEPTH)
+                return false;
+            depth[node.first]= std::max(depth[node.first], depth[i] +1);
+            depth[node.first +1]= std::max(depth[node.first +1], depth[i] +1);
+        }
+    }
+
+    for(uint64_t i= 0; i < n; i++)
+        if(indices[i] < 0 || uint64_t(indices[i]) >= n || ids[i] < 0 || uint64_t(ids[i]) >= n)
+            return false;
+
+    return true;
+}
+
+// chemin complet : /... ou c:\...
+bool absolute_path( const std::string& filename )
+{
+    return (!filename.empty() && (filename[0] == '/' || filename[0] == '\\')) || (filename.size() > 1 && filename[1] == ':');
+}
+
+// chemin complet, depuis le repertoire courant
+std::string current_path( const std::string& filename )
+{
+    if(absolute_path(filename))
+        return filename;
+
+    char tmp[4096];
+    if(getcwd(tmp, sizeof(tmp)) == nullptr)
+        return filename;
+    return std::string(tmp) + "/" + filename;
+}
+
+// decoupe un chemin en noms de repertoires, sans les . et en supprimant les repertoires suivis de .., sauf au debut d'un chemin relatif
+std::vector<std::string> split_path( const std::string& filename )
+{
+    std::vector<std::string> names;
+    std::string name;
+    for(size_t i= 0; i <= filename.size(); i++)
+    {
+        if(i < filename.size() && filename[i] != '/' && filename[i] != '\\')
+        {
+            name.push_back(filename[i]);
+            continue;
+        }
+
+        if(name == ".." && !names.empty() && names.back() != "..")
+            names.pop_back();
+        else if(!name.empty() && name != ".")
+            names.push_back(name);
+        name.clear();
+    }
+    return names;
+}
+
+/* nom de filename relatif au repertoire directory : compare les noms complets des repertoires, et remonte avec ../ pour chaque repertoire different.
+    renvoie le chemin complet de filename, si directory est sur un autre disque, par exemple.
+ */
+std::string relative_path( const std::string& filename, const std::string& directory )
+{
+    std::vector<std::string> file= split_path(filename);
+    std::vector<std::string> dir= split_path(directory);
+    bool absolute= absolute_path(filename);
+    if(absolute != absolute_path(directory) || (!dir.empty() && dir[0] == "..") || (!file.empty() && file[0] == ".."))
+    {
+        // un seul chemin complet, ou les chemins remontent au dessus du repertoire courant : compare les chemins complets
+        absolute= true;
+        file= split_path(current_path(filename));
+        dir= split_path(current_path(directory));
+    }
+
+    size_t common= 0;
+    while(common +1 < file.size() && common < dir.size() && file[common] == dir[common])
+        common++;
+
+    // pas de repertoire commun entre 2 chemins complets, par exemple 2 disques differents sous windows
+    if(absolute && common == 0)
+        return normalize_filename(current_path(filename));
+
+    std::string name;
+    for(size_t i= common; i < dir.size(); i++)
+        name+= "../";
+    for(size_t i= common; i < file.size(); i++)
+    {
+        name+= file[i];
+        if(i +1 < file.size())
+            name+= "/";
+    }
+    return name;
+}
+
+}
+
+
+bool write_scene( const char *filename, const Scene& scene, const View& view )
+{
+    uint64_t n= scene.spheres.size();
+    if(scene.bvh.indices.size() != n || scene.soa.ids.size() != n)
+    {
+        printf("[error] writing scene '%s': Scene::build() ?\n", filename);
+        return false;
+    }
+
+    FILE *out= fopen(filename, "wb");
+    if(!out)
+    {
+        printf("[error] writing scene '%s'...\n", filename);
+        return false;
+    }
+
+    printf("writing scene '%s'...\n", filename);
+
+    SceneHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, scene_magic, sizeof(scene_magic));
+    header.version= scene_version;
+    header.sphere_size= sizeof(Sphere);
+    header.plan_size= sizeof(Plan);
+    header.light_size= sizeof(Lumiere);
+    header.node_size= sizeof(BVHNode);
+
+    float v[10]= { view.from.x, view.from.y, view.from.z, view.to.x, view.to.y, view.to.z, view.up.x, view.up.y, view.up.z, view.fov };
+    memcpy(header.view, v, sizeof(v));
+
+    header.sphere_count= n;
+    header.plan_count= scene.plans.size();
+    header.light_count= scene.lums.size();
+    header.node_count= scene.bvh.nodes.size();
+    header.mesh_count= scene.instances.size();
+
+    // noms des objets, relatifs au repertoire du fichier de scene, ou chemins complets
+    std::string path= pathname(filename);
+    std::string names;
+    std::vector<MeshRecord> meshes;
+    for(const MeshInstance& instance : scene.instances)
+    {
+        std::string name= relative_path(instance.filename, path);
+
+        MeshRecord record;
+        for(int i= 0; i < 16; i++)
+            record.model[i]= instance.model.m[i / 4][i % 4];
+        record.name= names.size();
+        record.length= name.size();
+        meshes.push_back(record);
+        names+= name;
+    }
+
+    uint64_t offset= sizeof(SceneHeader);
+    header.spheres= allocate(offset, n, sizeof(Sphere));
+    header.plans= allocate(offset, header.plan_count, sizeof(Plan));
+    header.lights= allocate(offset, header.light_count, sizeof(Lumiere));
+    header.nodes= allocate(offset, header.node_count, sizeof(BVHNode));
+    header.indices= allocate(offset, n, sizeof(int));
+    header.cx= allocate(offset, n + scene_padding, sizeof(float));
+    header.cy= allocate(offset, n + scene_padding, sizeof(float));
+    header.cz= allocate(offset, n + scene_padding, sizeof(float));
+    header.r2= allocate(offset, n + scene_padding, sizeof(float));
+    header.ids= allocate(offset, n, sizeof(int));
+    header.meshes= allocate(offset, meshes.size(), sizeof(MeshRecord));
+    header.names= allocate(offset, names.size(), 1);
+
+    SceneWriter writer= { out, 0 };
+    bool error= !writer.write(0, &header, 1, sizeof(header))
+        || !writer.write(header.spheres, scene.spheres.data(), n, sizeof(Sphere))
+        || !writer.write(header.plans, scene.plans.data(), header.plan_count, sizeof(Plan))
+        || !writer.write(header.lights, scene.lums.data(), header.light_count, sizeof(Lumiere))
+        || !writer.write(header.nodes, scene.bvh.nodes.data(), header.node_count, sizeof(BVHNode))
+        || !writer.write(header.indices, scene.bvh.indices.data(), n, sizeof(int))
+        || !writer.write_padded(header.cx, scene.soa.cx, n)
+        || !writer.write_padded(header.cy, scene.soa.cy, n)
+        || !writer.write_padded(header.cz, scene.soa.cz, n)
+        || !writer.write_padded(header.r2, scene.soa.r2, n)
+        || !writer.write(header.ids, scene.soa.ids.data(), n, sizeof(int))
+        || !writer.write(header.meshes, meshes.data(), meshes.size(), sizeof(MeshRecord))
+        || !writer.write(header.names, names.data(), names.size(), 1);
+
+    if(fclose(out) != 0 || error)
+    {
+        printf("[error] writing scene '%s'...\n", filename);
+        return false;
+    }
+
+    return true;
+}
+
+
+bool read_scene( const char *filename, Scene& scene, View& view )
+{
+    scene= Scene();
+    view= View();
+
+    std::shared_ptr<MappedFile> file= map_file(filename);
+    if(file == nullptr)
+        return false;
+
+    if(file->size() < sizeof(SceneHeader) || memcmp(file->data(), scene_magic, sizeof(scene_magic)) != 0)
+    {
+        // pas un fichier binaire, format texte
+        file.reset();
+        return read_scene_text(filename, scene, view);
+    }
+
+    printf("loading scene '%s'...\n", filename);
+
+    SceneHeader header;
+    memcpy(&header, file->data(), sizeof(header));
+
+    uint64_t n= header.sphere_count;
+    if(header.version != scene_version
+    || header.sphere_size != sizeof(Sphere) || header.plan_size != sizeof(Plan) || header.light_size != sizeof(Lumiere) || header.node_size != sizeof(BVHNode)
+    || !inside(*file, header.spheres, n, sizeof(Sphere))
+    || !inside(*file, header.plans, header.plan_count, sizeof(Plan))
+    || !inside(*file, header.lights, header.light_count, sizeof(Lumiere))
+    || !inside(*file, header.nodes, header.node_count, sizeof(BVHNode))
+    || !inside(*file, header.indices, n, sizeof(int))
+    || !inside(*file, header.cx, n + scene_padding, sizeof(float))
+    || !inside(*file, header.cy, n + scene_padding, sizeof(float))
+    || !inside(*file, header.cz, n + scene_padding, sizeof(float))
+    || !inside(*file, header.r2, n + scene_padding, sizeof(float))
+    || !inside(*file, header.ids, n, sizeof(int))
+    || !inside(*file, header.meshes, header.mesh_count, sizeof(MeshRecord)))
+    {
+        printf("[error] loading scene '%s': incompatible file...\n", filename);
+        return false;
+    }
+
+    const char *data= file->data();
+    if(!valid_bvh((const BVHNode *) (data + header.nodes), header.node_count, (const int *) (data + header.indices), (const int *) (data + header.ids), n))
+    {
+        printf("[error] loading scene '%s': invalid bvh...\n", filename);
+        return false;
+    }
+
+    const float *v= header.view;
+    view= View(Point(v[0], v[1], v[2]), Point(v[3], v[4], v[5]), Vector(v[6], v[7], v[8]), v[9]);
+
+    // spheres, bvh et stockage par composantes : utilises directement dans le fichier, qui reste projete tant que la scene les reference
+    std::shared_ptr<const void> owner= file;
+    scene.spheres= Buffer<Sphere>((const Sphere *) (data + header.spheres), n, owner);
+    scene.bvh.nodes= Buffer<BVHNode>((const BVHNode *) (data + header.nodes), header.node_count, owner);
+    scene.bvh.indices= Buffer<int>((const int *) (data + header.indices), n, owner);
+    scene.soa.cx= Buffer<float>((const float *) (data + header.cx), n + scene_padding, owner);
+    scene.soa.cy= Buffer<float>((const float *) (data + header.cy), n + scene_padding, owner);
+    scene.soa.cz= Buffer<float>((const float *) (data + header.cz), n + scene_padding, owner);
+    scene.soa.r2= Buffer<float>((const float *) (data + header.r2), n + scene_padding, owner);
+    scene.soa.ids= Buffer<int>((const int *) (data + header.ids), n, owner);
+
+    const Plan *plans= (const Plan *) (data + header.plans);
+    scene.plans.assign(plans, plans + header.plan_count);
+    const Lumiere *lights= (const Lumiere *) (data + header.lights);
+    scene.lums.assign(lights, lights + header.light_count);
+
+    // objets
+    std::string path= pathname(filename);
+    const MeshRecord *meshes= (const MeshRecord *) (data + header.meshes);
+    for(uint64_t i= 0; i < header.mesh_count; i++)
+    {
+        if(!inside(*file, header.names + meshes[i].name, meshes[i].length, 1))
+        {
+            printf("[error] loading scene '%s': incompatible file...\n", filename);
+            return false;
+        }
+
+        std::string name(data + header.names + meshes[i].name, meshes[i].length);
+        std::string mesh= absolute_path(name) ? normalize_filename(name) : normalize_filename(path + name);
+        MeshIOData objet= read_meshio_data(mesh.c_str());
+        if(objet.positions.empty())
+            return false;
+
+        Transform model;
+        for(int k= 0; k < 16; k++)
+            model.m[k / 4][k % 4]= meshes[i].model[k];
+        scene.add_mesh(objet, model, mesh.c_str());
+    }
+
+    scene.build_triangles();
+    return true;
+}
@@ -0,0 +1,39 @@
+
+#ifndef _SCENE_IO_H
+#define _SCENE_IO_H
+
+#include "scene.h"
+#include "camera.h"
+
+
+//! \file
+//! fichiers de scene : format texte, pour decrire une scene, et format binaire, projete en memoire et utilise sans conversion.
+
+/*! charge une scene et sa camera, format texte ou binaire (reconnu par son entete). la scene est remplacee, et construite, inutile d'appeler Scene::build().
+
+    format texte, une description par ligne, les lignes qui commencent par # sont des commentaires :
+    \code
+    # camera : position, point observe, verticale, champ de vision vertical en degres
+    camera 0 0 0  0 0 -1  0 1 0  90
+    # sphere : centre, rayon, couleur
+    sphere -1 0 -3  1  1 0 0
+    # plan : point, normale, couleur
+    plan 0 -1 0  0 1 0  0.1 0.7 0.1
+    # lumiere : direction, couleur
+    lumiere 1 0.5 0  0.7 0.1 0.3
+    # objet : fichier .obj, relatif au fichier de scene, puis sa position et son echelle, optionnelles
+    objet robot.obj  3 -1 -3  0.5
+    \endcode
+
+    format binaire, cf write_scene() : les spheres, leur bvh et leur stockage par composantes sont utilises directement dans le fichier projete en memoire, cf MappedFile et Buffer,
+    sans les lire, ni reconstruire le bvh. le chargement ne depend pas du nombre de spheres, seuls les objets references sont charges et leurs triangles construits.
+ */
+bool read_scene( const char *filename, Scene& scene, View& view );
+
+/*! enregistre une scene construite (cf Scene::build()) et sa camera, au format binaire.
+    les objets sont references par leur fichier, cf Scene::instances, relatif au repertoire du fichier de scene (avec ../ si necessaire), ou par leur chemin complet.
+    le fichier est lu par read_scene() sur une machine de meme architecture (taille des types et ordre des octets), la version et les tailles sont verifiees au chargement.
+ */
+bool write_scene( const char *filename, const Scene& scene, const View& view );
+
+#endif
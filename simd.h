@@ -0,0 +1,215 @@
+
+#ifndef _SIMD_H
+#define _SIMD_H
+
+#include <cmath>
+
+
+//! \addtogroup math
+///@{
+
+//! \file
+/*! calculs simd sur des groupes de SIMD_WIDTH floats : 8 avec avx2, 4 avec sse2, 1 sinon.
+    les kernels s'ecrivent une seule fois avec vfloat / vbool, le jeu d'instructions est choisi a la compilation, cf -march=native.
+
+    exemple :
+    \code
+    // y[i]= a*x[i] + y[i], n multiple de SIMD_WIDTH
+    for(int i= 0; i < n; i+= SIMD_WIDTH)
+    {
+        vfloat vx= vload(x + i);
+        vfloat vy= vload(y + i);
+        vstore(y + i, vfloat(a) * vx + vy);
+    }
+    \endcode
+*/
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+
+//! nombre de floats par groupe.
+const int SIMD_WIDTH= 8;
+
+//! groupe de floats.
+struct vfloat
+{
+    vfloat( ) {}
+    vfloat( const __m256 _v ) : v(_v) {}
+    //! initialise tous les elements avec x.
+    explicit vfloat( const float x ) : v(_mm256_set1_ps(x)) {}
+
+    __m256 v;
+};
+
+//! groupe de booleens, resultat d'une comparaison.
+struct vbool
+{
+    vbool( ) {}
+    vbool( const __m256 _v ) : v(_v) {}
+
+    __m256 v;
+};
+
+inline vfloat vload( const float *p ) { return _mm256_loadu_ps(p); }
+inline void vstore( float *p, const vfloat a ) { _mm256_storeu_ps(p, a.v); }
+
+inline vfloat operator+ ( const vfloat a, const vfloat b ) { return _mm256_add_ps(a.v, b.v); }
+inline vfloat operator- ( const vfloat a, const vfloat b ) { return _mm256_sub_ps(a.v, b.v); }
+inline vfloat operator* ( const vfloat a, const vfloat b ) { return _mm256_mul_ps(a.v, b.v); }
+inline vfloat operator/ ( const vfloat a, const vfloat b ) { return _mm256_div_ps(a.v, b.v); }
+inline vfloat operator- ( const vfloat a ) { return _mm256_xor_ps(a.v, _mm256_set1_ps(-0.f)); }
+inline vfloat vsqrt( const vfloat a ) { return _mm256_sqrt_ps(a.v); }
+inline vfloat vmin( const vfloat a, const vfloat b ) { return _mm256_min_ps(a.v, b.v); }
+inline vfloat vmax( const vfloat a, const vfloat b ) { return _mm256_max_ps(a.v, b.v); }
+
+inline vbool operator< ( const vfloat a, const vfloat b ) { return _mm256_cmp_ps(a.v, b.v, _CMP_LT_OQ); }
+inline vbool operator<= ( const vfloat a, const vfloat b ) { return _mm256_cmp_ps(a.v, b.v, _CMP_LE_OQ); }
+inline vbool operator> ( const vfloat a, const vfloat b ) { return _mm256_cmp_ps(a.v, b.v, _CMP_GT_OQ); }
+inline vbool operator>= ( const vfloat a, const vfloat b ) { return _mm256_cmp_ps(a.v, b.v, _CMP_GE_OQ); }
+inline vbool operator& ( const vbool a, const vbool b ) { return _mm256_and_ps(a.v, b.v); }
+inline vbool operator| ( const vbool a, const vbool b ) { return _mm256_or_ps(a.v, b.v); }
+
+//! renvoie m ? a : b, pour chaque element.
+inline vfloat vselect( const vbool m, const vfloat a, const vfloat b ) { return _mm256_blendv_ps(b.v, a.v, m.v); }
+//! renvoie les booleens sous forme de bits, l'element i correspond au bit i.
+inline int vbits( const vbool m ) { return _mm256_movemask_ps(m.v); }
+//! renvoie vrai pour les n premiers elements.
+inline vbool vfirst( const int n ) { return _mm256_castsi256_ps(_mm256_cmpgt_epi32(_mm256_set1_epi32(n), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7))); }
+
+//! renvoie l'entier le plus grand inferieur ou egal a a.
+inline vfloat vfloor( const vfloat a ) { return _mm256_floor_ps(a.v); }
+//! decompose a > 0, normalise, en m * 2^e : renvoie la mantisse m dans [1 .. 2[ et l'exposant entier e.
+inline vfloat vmantissa( const vfloat a, vfloat& e )
+{
+    __m256i bits= _mm256_castps_si256(a.v);
+    e= _mm256_cvtepi32_ps(_mm256_sub_epi32(_mm256_srli_epi32(bits, 23), _mm256_set1_epi32(127)));
+    return _mm256_castsi256_ps(_mm256_or_si256(_mm256_and_si256(bits, _mm256_set1_epi32(0x007fffff)), _mm256_set1_epi32(0x3f800000)));
+}
+//! renvoie a * 2^e, e entier dans [-126 .. 127].
+inline vfloat vldexp( const vfloat a, const vfloat e )
+{
+    __m256i bits= _mm256_slli_epi32(_mm256_add_epi32(_mm256_cvtps_epi32(e.v), _mm256_set1_epi32(127)), 23);
+    return _mm256_mul_ps(a.v, _mm256_castsi256_ps(bits));
+}
+
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+
+const int SIMD_WIDTH= 4;
+
+struct vfloat
+{
+    vfloat( ) {}
+    vfloat( const __m128 _v ) : v(_v) {}
+    explicit vfloat( const float x ) : v(_mm_set1_ps(x)) {}
+
+    __m128 v;
+};
+
+struct vbool
+{
+    vbool( ) {}
+    vbool( const __m128 _v ) : v(_v) {}
+
+    __m128 v;
+};
+
+inline vfloat vload( const float *p ) { return _mm_loadu_ps(p); }
+inline void vstore( float *p, const vfloat a ) { _mm_storeu_ps(p, a.v); }
+
+inline vfloat operator+ ( const vfloat a, const vfloat b ) { return _mm_add_ps(a.v, b.v); }
+inline vfloat operator- ( const vfloat a, const vfloat b ) { return _mm_sub_ps(a.v, b.v); }
+inline vfloat operator* ( const vfloat a, const vfloat b ) { return _mm_mul_ps(a.v, b.v); }
+inline vfloat operator/ ( const vfloat a, const vfloat b ) { return _mm_div_ps(a.v, b.v); }
+inline vfloat operator- ( const vfloat a ) { return _mm_xor_ps(a.v, _mm_set1_ps(-0.f)); }
+inline vfloat vsqrt( const vfloat a ) { return _mm_sqrt_ps(a.v); }
+inline vfloat vmin( const vfloat a, const vfloat b ) { return _mm_min_ps(a.v, b.v); }
+inline vfloat vmax( const vfloat a, const vfloat b ) { return _mm_max_ps(a.v, b.v); }
+
+inline vbool operator< ( const vfloat a, const vfloat b ) { return _mm_cmplt_ps(a.v, b.v); }
+inline vbool operator<= ( const vfloat a, const vfloat b ) { return _mm_cmple_ps(a.v, b.v); }
+inline vbool operator> ( const vfloat a, const vfloat b ) { return _mm_cmpgt_ps(a.v, b.v); }
+inline vbool operator>= ( const vfloat a, const vfloat b ) { return _mm_cmpge_ps(a.v, b.v); }
+inline vbool operator& ( const vbool a, const vbool b ) { return _mm_and_ps(a.v, b.v); }
+inline vbool operator| ( const vbool a, const vbool b ) { return _mm_or_ps(a.v, b.v); }
+
+// pas de blend en sse2...
+inline vfloat vselect( const vbool m, const vfloat a, const vfloat b ) { return _mm_or_ps(_mm_and_ps(m.v, a.v), _mm_andnot_ps(m.v, b.v)); }
+inline int vbits( const vbool m ) { return _mm_movemask_ps(m.v); }
+inline vbool vfirst( const int n ) { return _mm_castsi128_ps(_mm_cmpgt_epi32(_mm_set1_epi32(n), _mm_setr_epi32(0, 1, 2, 3))); }
+
+// pas de floor en sse2, troncature puis correction des negatifs...
+inline vfloat vfloor( const vfloat a )
+{
+    __m128 t= _mm_cvtepi32_ps(_mm_cvttps_epi32(a.v));
+    return _mm_sub_ps(t, _mm_and_ps(_mm_cmpgt_ps(t, a.v), _mm_set1_ps(1.f)));
+}
+inline vfloat vmantissa( const vfloat a, vfloat& e )
+{
+    __m128i bits= _mm_castps_si128(a.v);
+    e= _mm_cvtepi32_ps(_mm_sub_epi32(_mm_srli_epi32(bits, 23), _mm_set1_epi32(127)));
+    return _mm_castsi128_ps(_mm_or_si128(_mm_and_si128(bits, _mm_set1_epi32(0x007fffff)), _mm_set1_epi32(0x3f800000)));
+}
+inline vfloat vldexp( const vfloat a, const vfloat e )
+{
+    __m128i bits= _mm_slli_epi32(_mm_add_epi32(_mm_cvtps_epi32(e.v), _mm_set1_epi32(127)), 23);
+    return _mm_mul_ps(a.v, _mm_castsi128_ps(bits));
+}
+
+#else
+
+const int SIMD_WIDTH= 1;
+
+struct vfloat
+{
+    vfloat( ) {}
+    explicit vfloat( const float x ) : v(x) {}
+
+    float v;
+};
+
+struct vbool
+{
+    vbool( ) {}
+    vbool( const bool _v ) : v(_v) {}
+
+    bool v;
+};
+
+inline vfloat vload( const float *p ) { return vfloat(*p); }
+inline void vstore( float *p, const vfloat a ) { *p= a.v; }
+
+inline vfloat operator+ ( const vfloat a, const vfloat b ) { return vfloat(a.v + b.v); }
+inline vfloat operator- ( const vfloat a, const vfloat b ) { return vfloat(a.v - b.v); }
+inline vfloat operator* ( const vfloat a, const vfloat b ) { return vfloat(a.v * b.v); }
+inline vfloat operator/ ( const vfloat a, const vfloat b ) { return vfloat(a.v / b.v); }
+inline vfloat operator- ( const vfloat a ) { return vfloat(-a.v); }
+inline vfloat vsqrt( const vfloat a ) { return vfloat(std::sqrt(a.v)); }
+inline vfloat vmin( const vfloat a, const vfloat b ) { return vfloat(a.v < b.v ? a.v : b.v); }
+inline vfloat vmax( const vfloat a, const vfloat b ) { return vfloat(a.v > b.v ? a.v : b.v); }
+
+inline vbool operator< ( const vfloat a, const vfloat b ) { return a.v < b.v; }
+inline vbool operator<= ( const vfloat a, const vfloat b ) { return a.v <= b.v; }
+inline vbool operator> ( const vfloat a, const vfloat b ) { return a.v > b.v; }
+inline vbool operator>= ( const vfloat a, const vfloat b ) { return a.v >= b.v; }
+inline vbool operator& ( const vbool a, const vbool b ) { return a.v && b.v; }
+inline vbool operator| ( const vbool a, const vbool b ) { return a.v || b.v; }
+
+inline vfloat vselect( const vbool m, const vfloat a, const vfloat b ) { return m.v ? a : b; }
+inline int vbits( const vbool m ) { return m.v ? 1 : 0; }
+inline vbool vfirst( const int n ) { return n > 0; }
+
+inline vfloat vfloor( const vfloat a ) { return vfloat(std::floor(a.v)); }
+inline vfloat vmantissa( const vfloat a, vfloat& e )
+{
+    int exponent;
+    float m= std::frexp(a.v, &exponent);
+    e= vfloat(float(exponent - 1));
+    return vfloat(2 * m);
+}
+inline vfloat vldexp( const vfloat a, const vfloat e ) { return vfloat(std::ldexp(a.v, int(e.v))); }
+
+#endif
+
+///@}
+#endif
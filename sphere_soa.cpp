@@ -0,0 +1,121 @@
+
+#include <cassert>
+
+#include "sphere_soa.h"
+#include "scene.h"
+#include "simd.h"
+
+
+void SphereSoA::build( const Buffer<Sphere>& spheres, const Buffer<int>& order )
+{
+    int n= order.empty() ? int(spheres.size()) : int(order.size());
+
+    ids.resize(n);
+    // complete les tableaux avec un groupe de spheres inutilisees, cf intersect_spheres_soa()
+    cx.assign(n + SIMD_WIDTH, 0);
+    cy.assign(n + SIMD_WIDTH, 0);
+    cz.assign(n + SIMD_WIDTH, 0);
+    r2.assign(n + SIMD_WIDTH, 0);
+
+    for(int i= 0; i < n; i++)
+    {
+        int id= order.empty() ? i : order[i];
+        const Sphere& sphere= spheres[id];
+        cx[i]= sphere.c.x;
+        cy[i]= sphere.c.y;
+        cz[i]= sphere.c.z;
+        r2[i]= sphere.r * sphere.r;
+        ids[i]= id;
+    }
+}
+
+
+namespace {
+
+// rayon replique sur tous les elements d'un groupe
+struct RayLanes
+{
+    vfloat ox, oy, oz;
+    vfloat dx, dy, dz;
+    vfloat a;
+    vfloat inva;
+
+    RayLanes( const Point& o, const Vector& d ) : ox(o.x), oy(o.y), oz(o.z), dx(d.x), dy(d.y), dz(d.z)
+    {
+        float da= dot(d, d);
+        a= vfloat(da);
+        inva= vfloat(1 / da);
+    }
+};
+
+/* intersection du rayon avec les spheres [i .. i + SIMD_WIDTH[, renvoie pour chaque sphere la plus petite racine positive dans t,
+    et vrai si elle est avant tmax. les elements au dela de end sont ignores.
+    comme a= dot(d, d) > 0, t1 <= t2 : la plus petite racine positive est t1 si t1 >= 0, sinon t2, pas besoin de tester tous les cas.
+ */
+inline vbool intersect_group( const SphereSoA& spheres, const int i, const int end, const RayLanes& ray, const vfloat tmax, vfloat& t )
+{
+    vfloat ocx= ray.ox - vload(spheres.cx.data() + i);
+    vfloat ocy= ray.oy - vload(spheres.cy.data() + i);
+    vfloat ocz= ray.oz - vload(spheres.cz.data() + i);
+
+    // b/2, et discriminant/4 : evite les facteurs 2 et 4 de la forme habituelle
+    vfloat b= ray.dx * ocx + ray.dy * ocy + ray.dz * ocz;
+    vfloat k= ocx * ocx + ocy * ocy + ocz * ocz - vload(spheres.r2.data() + i);
+    vfloat delta= b * b - ray.a * k;
+
+    vfloat zero= vfloat(0.f);
+    vfloat s= vsqrt(vmax(delta, zero));     // une seule racine carree par sphere
+    vfloat t1= (-b - s) * ray.inva;
+    vfloat t2= (-b + s) * ray.inva;
+    t= vselect(t1 >= zero, t1, t2);
+
+    return (delta >= zero) & (t >= zero) & (t < tmax) & vfirst(end - i);
+}
+
+}
+
+
+int intersect_spheres_soa( const SphereSoA& spheres, const int begin, const int end, const Point& o, const Vector& d, float& tmax )
+{
+    assert(end <= spheres.size());
+
+    RayLanes ray(o, d);
+    int hit= -1;
+    for(int i= begin; i < end; i+= SIMD_WIDTH)
+    {
+        vfloat t;
+        int bits= vbits( intersect_group(spheres, i, end, ray, vfloat(tmax), t) );
+        if(bits == 0)
+            continue;
+
+        // plus proche intersection du groupe
+        float ts[SIMD_WIDTH];
+        vstore(ts, t);
+        for(int k= 0; k < SIMD_WIDTH; k++)
+        {
+            if((bits & (1 << k)) && ts[k] < tmax)
+            {
+                tmax= ts[k];
+                hit= i + k;
+            }
+        }
+    }
+
+    return hit;
+}
+
+bool occluded_spheres_soa( const SphereSoA& spheres, const int begin, const int end, const Point& o, const Vector& d, const float tmax )
+{
+    assert(end <= spheres.size());
+
+    RayLanes ray(o, d);
+    vfloat vtmax= vfloat(tmax);
+    for(int i= begin; i < end; i+= SIMD_WIDTH)
+    {
+        vfloat t;
+        if(vbits( intersect_group(spheres, i, end, ray, vtmax, t) ))
+            return true;
+    }
+
+    return false;
+}
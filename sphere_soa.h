@@ -0,0 +1,43 @@
+
+#ifndef _SPHERE_SOA_H
+#define _SPHERE_SOA_H
+
+#include <vector>
+
+#include "vec.h"
+#include "buffer.h"
+
+
+//! \file
+//! stockage des spheres par composantes (structure of arrays), et intersection d'un rayon avec plusieurs spheres a la fois.
+
+struct Sphere;
+
+/*! spheres stockees par composantes : chaque attribut est range dans un tableau separe, pour charger les attributs de SIMD_WIDTH spheres consecutives avec une seule instruction, cf simd.h.
+    les tableaux sont completes par SIMD_WIDTH spheres inutilisees, les kernels peuvent toujours charger un groupe complet.
+*/
+struct SphereSoA
+{
+    Buffer<float> cx, cy, cz;       //!< centres.
+    Buffer<float> r2;               //!< carres des rayons.
+    Buffer<int> ids;                //!< indices des spheres dans le tableau d'origine, pour retrouver leur matiere / couleur.
+
+    SphereSoA( ) : cx(), cy(), cz(), r2(), ids() {}
+
+    //! construit le stockage des spheres, dans l'ordre de order[] (par exemple BVH::indices), ou dans l'ordre de spheres[] si order est vide.
+    void build( const Buffer<Sphere>& spheres, const Buffer<int>& order= Buffer<int>() );
+
+    //! renvoie le nombre de spheres.
+    int size( ) const { return int(ids.size()); }
+};
+
+/*! intersection la plus proche du rayon o + t*d avec les spheres [begin .. end[, pour t dans [0 .. tmax[.
+    renvoie l'indice (dans SphereSoA) de la sphere la plus proche et raccourcit tmax, ou renvoie -1.
+    utilisable dans les feuilles d'un bvh, ou sur toutes les spheres [0 .. size()[ d'une scene sans bvh.
+*/
+int intersect_spheres_soa( const SphereSoA& spheres, const int begin, const int end, const Point& o, const Vector& d, float& tmax );
+
+//! renvoie vrai si une des spheres [begin .. end[ coupe le rayon o + t*d, pour t dans [0 .. tmax[.
+bool occluded_spheres_soa( const SphereSoA& spheres, const int begin, const int end, const Point& o, const Vector& d, const float tmax );
+
+#endif
@@ -0,0 +1,351 @@
+
+#include <cstdio>
+#include <cstring>
+#include <cmath>
+#include <algorithm>
+
+#include "texture_cache.h"
+#include "image_io.h"
+#include "mipmap.h"
+#include "files.h"
+
+
+namespace {
+
+// nombre de parties independantes du cache
+const int SHARDS= 16;
+
+const size_t TILE_BYTES= size_t(TEXTURE_TILE) * TEXTURE_TILE * sizeof(RGBA8);
+
+// entete des textures tuilees, suivie du nom de l'image source, puis des tuiles de chaque niveau, ligne par ligne
+struct TiledHeader
+{
+    char magic[4];      // "tile"
+    int32_t version;
+    int32_t width, height;
+    int32_t levels;
+    int32_t tile;
+    uint64_t source_timestamp;  // version de l'image source, cf SourceRecord dans mesh_cache.cpp
+    uint64_t source_size;
+    uint64_t source_length;     // longueur du nom de l'image source
+};
+
+const int32_t TILED_VERSION= 2;
+
+int tiles( const int size ) { return (size + TEXTURE_TILE -1) / TEXTURE_TILE; }
+
+// position de la tuile (tx, ty) d'un niveau dans le cache
+uint64_t tile_key( const int id, const int lod, const int tx, const int ty )
+{
+    return (uint64_t(id) << 40) | (uint64_t(lod) << 34) | (uint64_t(ty) << 17) | uint64_t(tx);
+}
+
+int shard_index( const uint64_t key )
+{
+    return int((key * 0x9e3779b97f4a7c15ull) >> 60) % SHARDS;
+}
+
+// lit l'entete d'une texture tuilee et verifie qu'elle est a jour : construite a partir de l'image source, qui n'a pas ete modifiee depuis
+bool read_tiled_header( const std::string& filename, const char *source, TiledHeader& header )
+{
+    FILE *in= fopen(filename.c_str(), "rb");
+    if(!in)
+        return false;
+
+    std::string name;
+    bool code= fread(&header, sizeof(header), 1, in) == 1
+        && memcmp(header.magic, "tile", 4) == 0 && header.version == TILED_VERSION && header.tile == TEXTURE_TILE
+        && header.width > 0 && header.height > 0 && header.levels > 0
+        && header.source_length <= file_size(filename) - sizeof(header);
+    if(code)
+    {
+        name.resize(header.source_length);
+        code= fread(&name[0], 1, name.size(), in) == name.size();
+    }
+    fclose(in);
+
+    std::string image= normalize_filename(source);
+    return code && name == image && header.source_timestamp == timestamp(image) && header.source_size == file_size(image);
+}
+
+// lit n octets a la position offset d'un fichier
+bool read_at( const std::string& filename, const uint64_t offset, void *data, const size_t n )
+{
+    FILE *in= fopen(filename.c_str(), "rb");
+    if(!in)
+        return false;
+
+#ifdef _MSC_VER
+    bool code= _fseeki64(in, int64_t(offset), SEEK_SET) == 0;
+#else
+    bool code= fseeko(in, off_t(offset), SEEK_SET) == 0;
+#endif
+    code= code && fread(data, 1, n, in) == n;
+    fclose(in);
+    return code;
+}
+
+}
+
+
+bool write_tiled_texture( const char *image_filename, const char *filename )
+{
+    ImageRGBA8 image= read_image_rgba8(image_filename);
+    if(image.size() == 0)
+        return false;
+
+    MipmapRGBA8 mipmap(image);
+
+    // fichier temporaire, renomme a la fin, cf write_mesh_cache()
+    std::string tmp= std::string(filename) + ".tmp";
+    FILE *out= fopen(tmp.c_str(), "wb");
+    if(!out)
+    {
+        printf("[error] writing tiled texture '%s'...\n", filename);
+        return false;
+    }
+
+    std::string source= normalize_filename(image_filename);
+    TiledHeader header= { { 't', 'i', 'l', 'e' }, TILED_VERSION, mipmap.width(), mipmap.height(), mipmap.levels(), TEXTURE_TILE,
+        timestamp(source), file_size(source), source.size() };
+    bool code= fwrite(&header, sizeof(header), 1, out) == 1
+        && fwrite(source.data(), 1, source.size(), out) == source.size();
+
+    // une ligne de tuiles a la fois, tuiles copiees en parallele
+    std::vector<RGBA8> row;
+    for(int lod= 0; lod < mipmap.levels() && code; lod++)
+    {
+        const ImageRGBA8& level= mipmap.level(lod);
+        int tiles_x= tiles(level.width());
+        row.resize(size_t(tiles_x) * TEXTURE_TILE * TEXTURE_TILE);
+
+        for(int ty= 0; ty < tiles(level.height()) && code; ty++)
+        {
+            #pragma omp parallel for schedule(static)
+            for(int tx= 0; tx < tiles_x; tx++)
+            {
+                RGBA8 *tile= row.data() + size_t(tx) * TEXTURE_TILE * TEXTURE_TILE;
+                for(int y= 0; y < TEXTURE_TILE; y++)
+                for(int x= 0; x < TEXTURE_TILE; x++)
+                    tile[y * TEXTURE_TILE + x]= level(tx * TEXTURE_TILE + x, ty * TEXTURE_TILE + y);     // pixel du bord en dehors de l'image
+            }
+
+            code= fwrite(row.data(), sizeof(RGBA8), row.size(), out) == row.size();
+        }
+    }
+
+    if(fclose(out) != 0 || !code || std::rename(tmp.c_str(), filename) != 0)
+    {
+        printf("[error] writing tiled texture '%s'...\n", filename);
+        std::remove(tmp.c_str());
+        return false;
+    }
+
+    return true;
+}
+
+
+TextureCache::TextureCache( const size_t max_bytes, const std::string& directory ) :
+    m_textures(), m_directory(directory), m_shard_bytes(std::max(max_bytes / SHARDS, TILE_BYTES)), m_shards(new Shard[SHARDS])
+{}
+
+int TextureCache::add( const char *filename )
+{
+    // nom de la texture tuilee
+    std::string tiled= cache_filename(filename, m_directory, ".tiles");
+
+    // convertit l'image, si necessaire
+    TiledHeader header;
+    if(!read_tiled_header(tiled, filename, header))
+    {
+        printf("converting texture '%s'...\n", filename);
+        if(!write_tiled_texture(filename, tiled.c_str()))
+            return -1;
+
+        if(!read_tiled_header(tiled, filename, header))
+        {
+            printf("[error] reading tiled texture '%s'...\n", tiled.c_str());
+            return -1;
+        }
+    }
+
+    Texture texture;
+    texture.filename= tiled;
+    texture.width= header.width;
+    texture.height= header.height;
+
+    size_t offset= sizeof(header) + header.source_length;
+    int w= header.width;
+    int h= header.height;
+    for(int lod= 0; lod < header.levels; lod++)
+    {
+        Level level= { w, h, tiles(w), tiles(h), offset };
+        texture.levels.push_back(level);
+
+        offset+= size_t(level.tiles_x) * level.tiles_y * TILE_BYTES;
+        w= std::max(1, w / 2);
+        h= std::max(1, h / 2);
+    }
+
+    if(file_size(tiled) < offset)
+    {
+        printf("[error] reading tiled texture '%s': truncated file...\n", tiled.c_str());
+        return -1;
+    }
+
+    m_textures.push_back(texture);
+    return int(m_textures.size()) -1;
+}
+
+bool TextureCache::add( const Materials& materials )
+{
+    bool code= true;
+    for(int i= 0; i < materials.filename_count(); i++)
+    {
+        if(add(materials.filename(i)) < 0)
+        {
+            // conserve la numerotation des textures, la texture manquante est blanche
+            m_textures.push_back(Texture());
+            code= false;
+        }
+    }
+
+    return code;
+}
+
+
+TextureCache::Tile TextureCache::tile( const int id, const int lod, const int tx, const int ty ) const
+{
+    uint64_t key= tile_key(id, lod, tx, ty);
+    Shard& shard= m_shards[shard_index(key)];
+    {
+        std::lock_guard<std::mutex> guard(shard.lock);
+        auto found= shard.tiles.find(key);
+        if(found != shard.tiles.end())
+        {
+            shard.hits++;
+            shard.lru.splice(shard.lru.begin(), shard.lru, found->second.second);
+            return found->second.first;
+        }
+        shard.misses++;
+    }
+
+    // charge la tuile, sans bloquer les autres threads
+    const Texture& texture= m_textures[id];
+    const Level& level= texture.levels[lod];
+    size_t offset= level.offset + (size_t(ty) * level.tiles_x + tx) * TILE_BYTES;
+
+    // seule la copie de la tuile reste en memoire, le fichier n'est pas projete
+    std::shared_ptr< std::vector<RGBA8> > data= std::make_shared< std::vector<RGBA8> >(size_t(TEXTURE_TILE) * TEXTURE_TILE);
+    if(!read_at(texture.filename, offset, data->data(), TILE_BYTES))
+        // fichier modifie ou supprime pendant le rendu, la tuile est blanche, comme une texture manquante
+        data->assign(data->size(), RGBA8(255, 255, 255, 255));
+
+    std::lock_guard<std::mutex> guard(shard.lock);
+    auto found= shard.tiles.find(key);
+    if(found != shard.tiles.end())
+    {
+        // chargee en meme temps par un autre thread
+        shard.lru.splice(shard.lru.begin(), shard.lru, found->second.second);
+        return found->second.first;
+    }
+
+    shard.lru.push_front(key);
+    shard.tiles.emplace(key, std::make_pair(Tile(data), shard.lru.begin()));
+    shard.bytes+= TILE_BYTES;
+
+    // libere les tuiles les moins recemment utilisees, les threads qui les utilisent encore gardent leur copie
+    while(shard.bytes > m_shard_bytes && shard.lru.size() > 1)
+    {
+        shard.tiles.erase(shard.lru.back());
+        shard.lru.pop_back();
+        shard.bytes-= TILE_BYTES;
+    }
+
+    return data;
+}
+
+Color TextureCache::texel( const int id, const int lod, const int x, const int y, Tile& tile, uint64_t& key ) const
+{
+    const Level& level= m_textures[id].levels[lod];
+    int px= std::max(0, std::min(x, level.width -1));
+    int py= std::max(0, std::min(y, level.height -1));
+    int tx= px / TEXTURE_TILE;
+    int ty= py / TEXTURE_TILE;
+
+    // les pixels voisins sont souvent dans la meme tuile
+    uint64_t k= tile_key(id, lod, tx, ty);
+    if(!tile || k != key)
+    {
+        tile= this->tile(id, lod, tx, ty);
+        key= k;
+    }
+
+    return (*tile)[(py % TEXTURE_TILE) * TEXTURE_TILE + px % TEXTURE_TILE].color();
+}
+
+Color TextureCache::texture_level( const int id, const float u, const float v, const int lod ) const
+{
+    const Texture& texture= m_textures[id];
+    if(texture.levels.empty())
+        return White();
+
+    int l= std::max(0, std::min(lod, int(texture.levels.size()) -1));
+    const Level& level= texture.levels[l];
+
+    // interpolation bilineaire, centres des pixels alignes sur tous les niveaux, cf MipmapT::texture_level()
+    float x= u * level.width - float(0.5);
+    float y= v * level.height - float(0.5);
+    float fx= std::floor(x);
+    float fy= std::floor(y);
+    float a= x - fx;
+    float b= y - fy;
+    int ix= int(fx);
+    int iy= int(fy);
+
+    Tile tile;
+    uint64_t key= 0;
+    return texel(id, l, ix, iy, tile, key)     * ((1 - a) * (1 - b))
+        + texel(id, l, ix+1, iy, tile, key)    * (a       * (1 - b))
+        + texel(id, l, ix, iy+1, tile, key)    * ((1 - a) * b)
+        + texel(id, l, ix+1, iy+1, tile, key)  * (a       * b);
+}
+
+Color TextureCache::texture( const int id, const float u, const float v, const float lod ) const
+{
+    const Texture& texture= m_textures[id];
+    if(texture.levels.empty())
+        return White();
+
+    float l= std::max(float(0), std::min(lod, float(texture.levels.size() -1)));
+    int l0= int(l);
+    float f= l - float(l0);
+    if(f == 0 || l0 +1 >= int(texture.levels.size()))
+        return texture_level(id, u, v, l0);
+
+    return texture_level(id, u, v, l0) * (1 - f) + texture_level(id, u, v, l0 +1) * f;
+}
+
+
+size_t TextureCache::bytes( ) const
+{
+    size_t n= 0;
+    for(int i= 0; i < SHARDS; i++)
+    {
+        std::lock_guard<std::mutex> guard(m_shards[i].lock);
+        n+= m_shards[i].bytes;
+    }
+    return n;
+}
+
+void TextureCache::stats( size_t& hits, size_t& misses ) const
+{
+    hits= 0;
+    misses= 0;
+    for(int i= 0; i < SHARDS; i++)
+    {
+        std::lock_guard<std::mutex> guard(m_shards[i].lock);
+        hits+= m_shards[i].hits;
+        misses+= m_shards[i].misses;
+    }
+}
@@ -0,0 +1,130 @@
+
+#ifndef _TEXTURE_CACHE_H
+#define _TEXTURE_CACHE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "color.h"
+#include "image_formats.h"
+#include "materials.h"
+
+
+//! \addtogroup image
+///@{
+
+//! \file
+//! cache de textures : textures converties en tuiles et en mipmaps sur disque, tuiles chargees a la demande, les moins recemment utilisees sont liberees.
+
+//! taille des tuiles, en pixels, 16Ko par tuile rgba 8 bits.
+const int TEXTURE_TILE= 64;
+
+/*! convertit une image en texture tuilee : mipmaps, cf MipmapT, decoupes en tuiles TEXTURE_TILE x TEXTURE_TILE rgba 8 bits, non compressees,
+    pour charger directement n'importe quelle tuile. les tuiles du bord sont completees par les pixels du bord de l'image.
+    le nom de l'image, sa date de modification et sa taille sont conserves pour verifier que la texture tuilee est a jour.
+*/
+bool write_tiled_texture( const char *image_filename, const char *filename );
+
+/*! cache de textures, utilisable par plusieurs threads en meme temps.
+    chaque texture est convertie une seule fois en texture tuilee, cf write_tiled_texture(), le fichier est reutilise tant que l'image n'est pas modifiee.
+    les tuiles sont lues dans le fichier lors de leur premiere utilisation, et les moins recemment utilisees sont liberees lorsque le cache depasse sa taille maximale.
+    le fichier n'est pas projete en memoire : seules les tuiles presentes dans le cache occupent de la memoire.
+    seuls les niveaux de detail utilises sont charges, par exemple les petits niveaux des textures loin de la camera.
+
+    le cache est decoupe en plusieurs parties independantes, chacune protegee par son mutex, pour limiter l'attente entre les threads.
+    une tuile liberee par le cache reste valide tant qu'un thread l'utilise.
+
+    \code
+    TextureCache cache(512 * 1024 * 1024);      // 512Mo
+    if(!cache.add(scene.mesh.materials))        // ajoute les textures avant le rendu, cf add()
+        return "erreur";
+
+    // rendu, en parallele
+    Color color= cache.texture(material.diffuse_texture, u, v, lod);
+    \endcode
+*/
+class TextureCache
+{
+public:
+    /*! cache de taille max_bytes, au moins une tuile par partie du cache.
+        directory : repertoire des textures tuilees, a cote des images si directory est vide, cf cache_filename().
+        le fichier d'une image "textures/bois.png" s'appelle "textures/bois.png.tiles", ou "directory/bois-<hash>.png.tiles".
+    */
+    TextureCache( const size_t max_bytes= size_t(256) * 1024 * 1024, const std::string& directory= std::string() );
+
+    /*! ajoute une texture, et la convertit si necessaire, renvoie son indice, ou -1 en cas d'erreur.
+        a utiliser avant le rendu, les textures ne peuvent pas etre ajoutees pendant que d'autres threads lisent le cache.
+    */
+    int add( const char *filename );
+    //! ajoute les textures des matieres, dans l'ordre de Materials::texture_filenames : Material::diffuse_texture est directement l'indice de la texture dans le cache.
+    bool add( const Materials& materials );
+
+    //! renvoie la couleur interpolee (bilineaire) aux coordonnees normalisees (u, v) [0 .. 1]x[0 .. 1] d'un niveau de la texture id, cf MipmapT::texture_level().
+    Color texture_level( const int id, const float u, const float v, const int lod ) const;
+    //! renvoie la couleur interpolee (trilineaire) aux coordonnees normalisees (u, v), cf MipmapT::texture() et ray_cone_lod().
+    Color texture( const int id, const float u, const float v, const float lod ) const;
+
+    //! renvoie le nombre de textures.
+    int count( ) const { return int(m_textures.size()); }
+    //! renvoie la largeur d'une texture, niveau 0.
+    int width( const int id ) const { return m_textures[id].width; }
+    //! renvoie la hauteur d'une texture, niveau 0.
+    int height( const int id ) const { return m_textures[id].height; }
+    //! renvoie le nombre de niveaux d'une texture.
+    int levels( const int id ) const { return int(m_textures[id].levels.size()); }
+
+    //! renvoie la taille des tuiles chargees, en octets.
+    size_t bytes( ) const;
+    //! renvoie le nombre de tuiles trouvees dans le cache, et le nombre de tuiles chargees.
+    void stats( size_t& hits, size_t& misses ) const;
+
+    TextureCache( const TextureCache& ) = delete;
+    TextureCache& operator= ( const TextureCache& ) = delete;
+
+protected:
+    typedef std::shared_ptr< const std::vector<RGBA8> > Tile;
+
+    struct Level
+    {
+        int width, height;
+        int tiles_x, tiles_y;
+        size_t offset;      // position de la premiere tuile dans le fichier
+    };
+
+    struct Texture
+    {
+        std::string filename;   // texture tuilee
+        int width, height;
+        std::vector<Level> levels;
+    };
+
+    // partie du cache : tuiles, et leur ordre d'utilisation, la plus recente en premier
+    struct Shard
+    {
+        std::mutex lock;
+        std::list<uint64_t> lru;
+        std::unordered_map< uint64_t, std::pair<Tile, std::list<uint64_t>::iterator> > tiles;
+        size_t bytes= 0;
+        size_t hits= 0;
+        size_t misses= 0;
+    };
+
+    //! renvoie une tuile, la charge si necessaire.
+    Tile tile( const int id, const int lod, const int tx, const int ty ) const;
+    //! renvoie la couleur d'un pixel d'un niveau, tile garde la derniere tuile utilisee.
+    Color texel( const int id, const int lod, const int x, const int y, Tile& tile, uint64_t& key ) const;
+
+    std::vector<Texture> m_textures;
+    std::string m_directory;
+    size_t m_shard_bytes;
+    mutable std::unique_ptr<Shard[]> m_shards;
+};
+
+///@}
+#endif
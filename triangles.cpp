@@ -0,0 +1,143 @@
+
+#include <cassert>
+
+#include "triangles.h"
+#include "mesh_io.h"
+#include "simd.h"
+
+
+void TriangleSoA::build( const MeshIOData& data, const Buffer<int>& order )
+{
+    int n= order.empty() ? int(data.indices.size() / 3) : int(order.size());
+
+    ids.resize(n);
+    // complete les tableaux avec un groupe de triangles inutilises, cf intersect_triangles_soa()
+    ax.assign(n + SIMD_WIDTH, 0);
+    ay.assign(n + SIMD_WIDTH, 0);
+    az.assign(n + SIMD_WIDTH, 0);
+    e1x.assign(n + SIMD_WIDTH, 0);
+    e1y.assign(n + SIMD_WIDTH, 0);
+    e1z.assign(n + SIMD_WIDTH, 0);
+    e2x.assign(n + SIMD_WIDTH, 0);
+    e2y.assign(n + SIMD_WIDTH, 0);
+    e2z.assign(n + SIMD_WIDTH, 0);
+
+    for(int i= 0; i < n; i++)
+    {
+        int id= order.empty() ? i : order[i];
+        const Point& a= data.positions[data.indices[3*id]];
+        const Point& b= data.positions[data.indices[3*id +1]];
+        const Point& c= data.positions[data.indices[3*id +2]];
+
+        ax[i]= a.x;
+        ay[i]= a.y;
+        az[i]= a.z;
+        e1x[i]= b.x - a.x;
+        e1y[i]= b.y - a.y;
+        e1z[i]= b.z - a.z;
+        e2x[i]= c.x - a.x;
+        e2y[i]= c.y - a.y;
+        e2z[i]= c.z - a.z;
+        ids[i]= id;
+    }
+}
+
+
+namespace {
+
+// rayon replique sur tous les elements d'un groupe
+struct RayLanes
+{
+    vfloat ox, oy, oz;
+    vfloat dx, dy, dz;
+
+    RayLanes( const Point& o, const Vector& d ) : ox(o.x), oy(o.y), oz(o.z), dx(d.x), dy(d.y), dz(d.z) {}
+};
+
+/* intersection du rayon avec les triangles [i .. i + SIMD_WIDTH[, test de Moller-Trumbore : renvoie pour chaque triangle la position t sur le rayon et les coordonnees barycentriques u, v,
+    et vrai si le point est dans le triangle, avant tmax. les elements au dela de end sont ignores.
+    les triangles sont visibles des 2 cotes, det peut etre negatif. les triangles degeneres (det == 0) sont ignores.
+ */
+inline vbool intersect_group( const TriangleSoA& triangles, const int i, const int end, const RayLanes& ray, const vfloat tmax, vfloat& t, vfloat& u, vfloat& v )
+{
+    vfloat e1x= vload(triangles.e1x.data() + i), e1y= vload(triangles.e1y.data() + i), e1z= vload(triangles.e1z.data() + i);
+    vfloat e2x= vload(triangles.e2x.data() + i), e2y= vload(triangles.e2y.data() + i), e2z= vload(triangles.e2z.data() + i);
+
+    // p= cross(d, e2)
+    vfloat px= ray.dy * e2z - ray.dz * e2y;
+    vfloat py= ray.dz * e2x - ray.dx * e2z;
+    vfloat pz= ray.dx * e2y - ray.dy * e2x;
+    vfloat det= e1x * px + e1y * py + e1z * pz;
+    vfloat inv= vfloat(1.f) / det;
+
+    // s= o - a
+    vfloat sx= ray.ox - vload(triangles.ax.data() + i);
+    vfloat sy= ray.oy - vload(triangles.ay.data() + i);
+    vfloat sz= ray.oz - vload(triangles.az.data() + i);
+    u= (sx * px + sy * py + sz * pz) * inv;
+
+    // q= cross(s, e1)
+    vfloat qx= sy * e1z - sz * e1y;
+    vfloat qy= sz * e1x - sx * e1z;
+    vfloat qz= sx * e1y - sy * e1x;
+    v= (ray.dx * qx + ray.dy * qy + ray.dz * qz) * inv;
+    t= (e2x * qx + e2y * qy + e2z * qz) * inv;
+
+    vfloat zero= vfloat(0.f);
+    return ((det > zero) | (det < zero)) & (u >= zero) & (v >= zero) & (u + v <= vfloat(1.f))
+        & (t >= zero) & (t < tmax) & vfirst(end - i);
+}
+
+}
+
+
+int intersect_triangles_soa( const TriangleSoA& triangles, const int begin, const int end, const Point& o, const Vector& d, float& tmax, float& u, float& v )
+{
+    assert(end <= triangles.size());
+
+    RayLanes ray(o, d);
+    int hit= -1;
+    for(int i= begin; i < end; i+= SIMD_WIDTH)
+    {
+        vfloat t, tu, tv;
+        int bits= vbits( intersect_group(triangles, i, end, ray, vfloat(tmax), t, tu, tv) );
+        if(bits == 0)
+            continue;
+
+        // plus proche intersection du groupe
+        float ts[SIMD_WIDTH];
+        float us[SIMD_WIDTH];
+        float vs[SIMD_WIDTH];
+        vstore(ts, t);
+        vstore(us, tu);
+        vstore(vs, tv);
+        for(int k= 0; k < SIMD_WIDTH; k++)
+        {
+            if((bits & (1 << k)) && ts[k] < tmax)
+            {
+                tmax= ts[k];
+                u= us[k];
+                v= vs[k];
+                hit= i + k;
+            }
+        }
+    }
+
+    return hit;
+}
+
+bool occluded_triangles_soa( const TriangleSoA& triangles, const int begin, const int end, const Point& o, const Vector& d, const float tmax )
+{
+    assert(end <= triangles.size());
+
+    RayLanes ray(o, d);
+    vfloat vtmax= vfloat(tmax);
+    for(int i= begin; i < end; i+= SIMD_WIDTH)
+    {
+        vfloat t, u, v;
+        if(vbits( intersect_group(triangles, i, end, ray, vtmax, t, u, v) ))
+            return true;
+    }
+
+    return false;
+}
@@ -0,0 +1,43 @@
+
+#ifndef _TRIANGLES_H
+#define _TRIANGLES_H
+
+#include <vector>
+
+#include "vec.h"
+#include "buffer.h"
+
+
+//! \file
+//! stockage des triangles par composantes, et intersection d'un rayon avec plusieurs triangles a la fois.
+
+struct MeshIOData;
+
+/*! triangles stockes par composantes, comme SphereSoA : sommet a et aretes ab, ac de chaque triangle, dans des tableaux separes.
+    les tableaux sont completes par SIMD_WIDTH triangles inutilises, les kernels peuvent toujours charger un groupe complet.
+*/
+struct TriangleSoA
+{
+    std::vector<float> ax, ay, az;      //!< sommets a.
+    std::vector<float> e1x, e1y, e1z;   //!< aretes ab.
+    std::vector<float> e2x, e2y, e2z;   //!< aretes ac.
+    std::vector<int> ids;               //!< indices des triangles dans MeshIOData, pour retrouver leur matiere, cf MeshIOData::material_indices.
+
+    TriangleSoA( ) : ax(), ay(), az(), e1x(), e1y(), e1z(), e2x(), e2y(), e2z(), ids() {}
+
+    //! construit le stockage des triangles indexes de data, dans l'ordre de order[] (par exemple BVH::indices), ou dans l'ordre de data.indices si order est vide.
+    void build( const MeshIOData& data, const Buffer<int>& order= Buffer<int>() );
+
+    //! renvoie le nombre de triangles.
+    int size( ) const { return int(ids.size()); }
+};
+
+/*! intersection la plus proche du rayon o + t*d avec les triangles [begin .. end[, pour t dans [0 .. tmax[, test de Moller-Trumbore.
+    renvoie l'indice (dans TriangleSoA) du triangle le plus proche, ses coordonnees barycentriques u, v et raccourcit tmax, ou renvoie -1.
+*/
+int intersect_triangles_soa( const TriangleSoA& triangles, const int begin, const int end, const Point& o, const Vector& d, float& tmax, float& u, float& v );
+
+//! renvoie vrai si un des triangles [begin .. end[ coupe le rayon o + t*d, pour t dans [0 .. tmax[.
+bool occluded_triangles_soa( const TriangleSoA& triangles, const int begin, const int end, const Point& o, const Vector& d, const float tmax );
+
+#endif